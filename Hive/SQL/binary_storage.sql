@@ -0,0 +1,16 @@
+-- ----------------------------
+-- Array columns that can hold the binary storage form (Characters.BinaryFormat / Objects.BinaryFormat)
+-- Text values stay readable after this, rows are converted by setting BinaryMigrate = true once
+-- ----------------------------
+ALTER TABLE `survivor`
+  MODIFY `inventory` blob,
+  MODIFY `backpack` blob,
+  MODIFY `medical` blob NOT NULL;
+
+ALTER TABLE `instance_vehicle`
+  MODIFY `inventory` blob,
+  MODIFY `parts` blob;
+
+ALTER TABLE `instance_deployable`
+  MODIFY `inventory` blob,
+  MODIFY `Hitpoints` blob;
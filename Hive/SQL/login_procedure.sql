@@ -0,0 +1,57 @@
+-- ----------------------------
+-- Single round trip character login, used by CHILD 101 when Characters.LoginProcedure is enabled
+-- Returns one row: new_player, new_char, id, worldspace, inventory, backpack,
+-- SurvivalTime, MinsLastAte, MinsLastDrank, model, profile_found, old_name
+-- id is NULL if the character couldn't be created, nothing is written in that case
+-- ----------------------------
+DROP PROCEDURE IF EXISTS `pCharacterLogin`;
+DELIMITER ;;
+CREATE PROCEDURE `pCharacterLogin`(IN p_unique_id VARCHAR(128), IN p_name VARCHAR(128), IN p_instance_id INT)
+BEGIN
+  DECLARE v_found TINYINT DEFAULT 0;
+  DECLARE v_old_name VARCHAR(128) DEFAULT NULL;
+  DECLARE v_new_player TINYINT DEFAULT 0;
+  DECLARE v_char_id INT DEFAULT NULL;
+  DECLARE EXIT HANDLER FOR SQLEXCEPTION
+  BEGIN
+    ROLLBACK;
+    RESIGNAL;
+  END;
+
+  START TRANSACTION;
+  SELECT 1, `name` INTO v_found, v_old_name FROM `profile` WHERE `unique_id` = p_unique_id;
+  IF v_found = 0 THEN
+    INSERT INTO `profile` (`unique_id`, `name`) VALUES (p_unique_id, p_name);
+    SET v_new_player = 1;
+  ELSEIF NOT (v_old_name <=> p_name) THEN
+    UPDATE `profile` SET `name` = p_name WHERE `unique_id` = p_unique_id;
+  END IF;
+
+  SELECT s.`id` INTO v_char_id FROM `survivor` s JOIN `instance` i ON s.`world_id` = i.`world_id` AND i.`id` = p_instance_id
+    WHERE s.`unique_id` = p_unique_id AND s.`is_dead` = 0 LIMIT 1;
+
+  IF v_char_id IS NOT NULL THEN
+    -- survival time is measured up to the previous login, so read before touching last_updated
+    SELECT v_new_player, 0, s.`id`, s.`worldspace`, s.`inventory`, s.`backpack`,
+      timestampdiff(minute, s.`start_time`, s.`last_updated`) AS `SurvivalTime`,
+      timestampdiff(minute, s.`last_ate`, NOW()) AS `MinsLastAte`,
+      timestampdiff(minute, s.`last_drank`, NOW()) AS `MinsLastDrank`,
+      s.`model`, v_found, v_old_name
+      FROM `survivor` s WHERE s.`id` = v_char_id;
+    UPDATE `survivor` SET `last_updated` = CURRENT_TIMESTAMP WHERE `id` = v_char_id;
+    COMMIT;
+  ELSE
+    INSERT INTO `survivor` (`unique_id`, `start_time`, `world_id`, `worldspace`, `inventory`, `backpack`, `medical`)
+      SELECT p_unique_id, NOW(), i.`world_id`, '[]', i.`inventory`, i.`backpack`, '[false,false,false,false,false,false,false,12000,[],[0,0],0]'
+      FROM `instance` i WHERE i.`id` = p_instance_id;
+    IF ROW_COUNT() > 0 THEN
+      SET v_char_id = LAST_INSERT_ID();
+      COMMIT;
+    ELSE
+      -- no character means no profile either, so the next login still counts as a new player
+      ROLLBACK;
+    END IF;
+    SELECT v_new_player, 1, v_char_id, '[]', NULL, NULL, 0, 0, 0, '', v_found, v_old_name;
+  END IF;
+END;;
+DELIMITER ;
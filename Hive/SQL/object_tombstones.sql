@@ -0,0 +1,42 @@
+-- ----------------------------
+-- Deleted object records, read by the delta object resync (CHILD 314)
+-- ----------------------------
+CREATE TABLE IF NOT EXISTS `object_tombstone` (
+  `id` bigint(20) UNSIGNED NOT NULL AUTO_INCREMENT,
+  `instance_id` int(11) NOT NULL,
+  `object_id` bigint(20) NOT NULL,
+  `deployable` tinyint(1) NOT NULL,
+  `deleted` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`id`),
+  KEY `instance_deleted` (`instance_id`,`deleted`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+
+-- ----------------------------
+-- Changed rows are found by last_updated, so it has to move on every insert and update
+-- ----------------------------
+ALTER TABLE `instance_vehicle`
+  MODIFY `last_updated` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
+  ADD KEY `instance_updated` (`instance_id`,`last_updated`);
+
+ALTER TABLE `instance_deployable`
+  MODIFY `last_updated` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
+  ADD KEY `instance_updated` (`instance_id`,`last_updated`);
+
+-- ----------------------------
+-- Triggers recording deletions
+-- ----------------------------
+DROP TRIGGER IF EXISTS `instance_vehicle_tombstone`;
+CREATE TRIGGER `instance_vehicle_tombstone` AFTER DELETE ON `instance_vehicle`
+  FOR EACH ROW INSERT INTO `object_tombstone` (`instance_id`, `object_id`, `deployable`) VALUES (OLD.`instance_id`, OLD.`id`, 0);
+
+DROP TRIGGER IF EXISTS `instance_deployable_tombstone`;
+CREATE TRIGGER `instance_deployable_tombstone` AFTER DELETE ON `instance_deployable`
+  FOR EACH ROW INSERT INTO `object_tombstone` (`instance_id`, `object_id`, `deployable`) VALUES (OLD.`instance_id`, OLD.`unique_id`, 1);
+
+-- ----------------------------
+-- Tombstones only need to outlive the longest expected resync gap
+-- (needs event_scheduler=ON)
+-- ----------------------------
+DROP EVENT IF EXISTS `object_tombstone_prune`;
+CREATE EVENT `object_tombstone_prune` ON SCHEDULE EVERY 1 DAY
+  DO DELETE FROM `object_tombstone` WHERE `deleted` < NOW() - INTERVAL 7 DAY;
@@ -45,6 +45,12 @@ public:
 	virtual unique_ptr<QueryResult> queryParams(const char* format,...) = 0;
 	virtual unique_ptr<QueryNamedResult> namedQueryParams(const char* format,...) = 0;
 
+	//rows come off the wire as fetchRow asks for them instead of being buffered up front, for big reads
+	//the pool connection stays taken until the last row is read or the result is destroyed (which skips the rest),
+	//numRows() counts the rows read so far, and the same thread shouldn't query anything else meanwhile
+	virtual unique_ptr<QueryResult> queryStreamed(const char* sql) = 0;
+	virtual unique_ptr<QueryResult> queryParamsStreamed(const char* format,...) = 0;
+
 	virtual bool directExecute(const char* sql) = 0;
 	virtual bool directExecuteParams(const char* format,...) = 0;
 
@@ -60,6 +66,17 @@ public:
 
 	virtual bool execute(const char* sql) = 0;
 	virtual bool executeParams(const char* format,...) = 0;
+	//async writes with the same shard key run in order on the same writer, unkeyed ones all go to the first writer
+	virtual bool executeKeyed(Int64 shardKey, const char* sql) = 0;
+	//like executeKeyed, but if the statement fails the fallbacks are run one by one in its place
+	virtual bool executeKeyedSplit(Int64 shardKey, const char* sql, const std::vector<std::string>& fallbacks) = 0;
+	//index of the async writer handling a shard key
+	virtual size_t asyncShardOf(Int64 shardKey) const = 0;
+	//taken right after queueing a keyed write, once asyncWriteDone says so that write (and everything before it on its writer) has run
+	virtual UInt64 asyncWriteTicket(Int64 shardKey) const = 0;
+	virtual bool asyncWriteDone(Int64 shardKey, UInt64 ticket) const = 0;
+	//longest statement the server takes (max_allowed_packet, less some headroom)
+	virtual size_t maxStatementBytes() = 0;
 
 	//Writes SQL commands to a LOG file
 	virtual bool executeParamsLog(const char* format,...) = 0;
@@ -94,4 +111,16 @@ public:
 
 	//Call this once you're out of global constructor code/DLLMain
 	virtual void allowAsyncOperations() = 0;
+
+	//number of async writer connections, each with its own delay thread (takes effect on initialise)
+	virtual void setAsyncWriters(size_t numWriters) = 0;
+
+	//async writes wait until at least minBatch are queued or the oldest is maxLingerMS old
+	virtual void setDelayPolicy(size_t minBatch, UInt32 maxLingerMS) = 0;
+	//commit up to maxOps queued writes, queued within maxMS of each other, in one transaction (1 disables)
+	virtual void setGroupCommit(size_t maxOps, UInt32 maxMS) = 0;
+
+	//sync query connections, the pool grows towards maxConns while queries wait longer than growWaitMS for one,
+	//and parks connections down to minConns once nobody waited for a while (takes effect on initialise)
+	virtual void setPoolPolicy(size_t minConns, size_t maxConns, UInt32 growWaitMS, UInt32 healthCheckSec) = 0;
 };
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #include "Shared/Common/Types.h"
 #include <Poco/NumberParser.h>
+#include <Poco/NumberFormatter.h>
 
 class Field
 {
@@ -33,30 +34,78 @@ public:
 		DB_TYPE_BOOL    = 0x04
 	};
 
-	Field() : _value(nullptr), _type(DB_TYPE_UNKNOWN) {}
-	Field(const char* value, enum DataTypes type) : _value(value), _type(type) {}
+	Field() : _value(nullptr), _length(NO_LENGTH), _type(DB_TYPE_UNKNOWN), _native(NATIVE_NONE) {}
+	Field(const char* value, enum DataTypes type) : _value(value), _length(NO_LENGTH), _type(type), _native(NATIVE_NONE) {}
 	~Field() {}
 
 	DataTypes getType() const { return _type; }
-	bool isNull() const { return _value == nullptr; }
+	bool isNull() const { return _value == nullptr && _native == NATIVE_NONE; }
 
-	const char* getCStr() const { return _value; }
+	const char* getCStr() const
+	{
+		if (_native != NATIVE_NONE)
+		{
+			std::string text = getString();
+			strncpy(_nativeText,text.c_str(),sizeof(_nativeText)-1);
+			_nativeText[sizeof(_nativeText)-1] = 0;
+			return _nativeText;
+		}
+		return _value;
+	}
 	std::string getString() const
 	{
+		switch (_native)
+		{
+		case NATIVE_INT: return Poco::NumberFormatter::format(_num.i64);
+		case NATIVE_UINT: return Poco::NumberFormatter::format(_num.u64);
+		case NATIVE_DOUBLE: return Poco::NumberFormatter::format(_num.dbl);
+		default: break;
+		}
 		//std::string s = 0 has undefined result
-		return _value ? _value : "";
+		if (!_value)
+			return "";
+		//binary values can contain zeroes, so use the length when the api gave us one
+		if (_length != NO_LENGTH)
+			return std::string(_value,_length);
+
+		return _value;
+	}
+	size_t getLength() const
+	{
+		if (_native != NATIVE_NONE)
+			return getString().length();
+		if (!_value)
+			return 0;
+		if (_length != NO_LENGTH)
+			return _length;
+
+		return strlen(_value);
+	}
+	double getDouble() const 
+	{ 
+		if (_native != NATIVE_NONE)
+			return nativeDouble();
+
+		return _value ? static_cast<double>(atof(_value)) : 0.0; 
 	}
-	double getDouble() const { return _value ? static_cast<double>(atof(_value)) : 0.0; }
 	float getFloat() const { return static_cast<float>(getDouble()); }
-	bool getBool() const { return _value ? atoi(_value) > 0 : false; }
-	Int32 getInt32() const { return _value ? static_cast<Int32>(atol(_value)) : Int32(0); }
-	Int8 getInt8() const { return _value ? static_cast<Int8>(atol(_value)) : Int8(0); }
-	UInt8 getUInt8() const { return _value ? static_cast<UInt8>(atol(_value)) : UInt8(0); }
-	UInt16 getUInt16() const { return _value ? static_cast<UInt16>(atol(_value)) : UInt16(0); }
-	Int16 getInt16() const { return _value ? static_cast<Int16>(atol(_value)) : Int16(0); }
-	UInt32 getUInt32() const { return _value ? static_cast<UInt32>(atol(_value)) : UInt32(0); }
+	bool getBool() const 
+	{ 
+		if (_native != NATIVE_NONE)
+			return nativeInt() > 0;
+
+		return _value ? atoi(_value) > 0 : false; 
+	}
+	Int32 getInt32() const { return static_cast<Int32>(getLong()); }
+	Int8 getInt8() const { return static_cast<Int8>(getLong()); }
+	UInt8 getUInt8() const { return static_cast<UInt8>(getLong()); }
+	UInt16 getUInt16() const { return static_cast<UInt16>(getLong()); }
+	Int16 getInt16() const { return static_cast<Int16>(getLong()); }
+	UInt32 getUInt32() const { return static_cast<UInt32>(getLong()); }
 	UInt64 getUInt64() const
 	{
+		if (_native != NATIVE_NONE)
+			return (_native == NATIVE_UINT) ? _num.u64 : static_cast<UInt64>(nativeInt());
 		if (!_value)
 			return 0;
 
@@ -66,12 +115,78 @@ public:
 
 		return parsedVal;
 	}
+	Int64 getInt64() const
+	{
+		if (_native != NATIVE_NONE)
+			return nativeInt();
+		if (!_value)
+			return 0;
+
+		Int64 parsedVal;
+		if (!Poco::NumberParser::tryParse64(_value,parsedVal))
+			return 0;
+
+		return parsedVal;
+	}
 
 	void setType(DataTypes type) { _type = type; }
 	//no need for memory allocations to store resultset field strings
 	//all we need is to cache pointers returned by different DBMS APIs
-	void setValue(const char* value) { _value = value; };
+	void setValue(const char* value) { _value = value; _length = NO_LENGTH; _native = NATIVE_NONE; };
+	void setValue(const char* value, size_t length) { _value = value; _length = length; _native = NATIVE_NONE; };
+	//binary protocol results hand us the numbers themselves, so there's nothing to parse
+	void setInt64(Int64 value) { _value = nullptr; _native = NATIVE_INT; _num.i64 = value; }
+	void setUInt64(UInt64 value) { _value = nullptr; _native = NATIVE_UINT; _num.u64 = value; }
+	void setDouble(double value) { _value = nullptr; _native = NATIVE_DOUBLE; _num.dbl = value; }
+	void setNull() { _value = nullptr; _native = NATIVE_NONE; }
 private:
+	static const size_t NO_LENGTH = ~size_t(0);
+
+	//same truncation as atol, which the text getters use
+	long getLong() const
+	{
+		if (_native != NATIVE_NONE)
+			return static_cast<long>(nativeInt());
+
+		return _value ? atol(_value) : 0;
+	}
+	Int64 nativeInt() const
+	{
+		switch (_native)
+		{
+		case NATIVE_UINT: return static_cast<Int64>(_num.u64);
+		case NATIVE_DOUBLE: return static_cast<Int64>(_num.dbl);
+		default: return _num.i64;
+		}
+	}
+	double nativeDouble() const
+	{
+		switch (_native)
+		{
+		case NATIVE_UINT: return static_cast<double>(_num.u64);
+		case NATIVE_DOUBLE: return _num.dbl;
+		default: return static_cast<double>(_num.i64);
+		}
+	}
+
+	enum NativeTypes
+	{
+		NATIVE_NONE,
+		NATIVE_INT,
+		NATIVE_UINT,
+		NATIVE_DOUBLE
+	};
+
 	const char* _value;
+	size_t _length;
 	enum DataTypes _type;
+
+	enum NativeTypes _native;
+	union
+	{
+		Int64 i64;
+		UInt64 u64;
+		double dbl;
+	} _num;
+	mutable char _nativeText[32];
 };
\ No newline at end of file
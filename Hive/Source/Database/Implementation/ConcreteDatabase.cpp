@@ -20,6 +20,7 @@
 #include "SqlOperations.h"
 #include "SqlConnection.h"
 #include "SqlStatementImpl.h"
+#include "SqlBulkBuilder.h"
 
 #include <ctime>
 #include <iostream>
@@ -27,12 +28,16 @@
 #include <memory>
 
 static const size_t MIN_CONNECTION_POOL_SIZE = 1;
-static const size_t MAX_CONNECTION_POOL_SIZE = 16;
 
 //////////////////////////////////////////////////////////////////////////
 
-ConcreteDatabase::ConcreteDatabase() : _shouldLogSQL(false), _currConn(0), _asyncAllowed(false), _logger(nullptr)
+ConcreteDatabase::ConcreteDatabase() : _shouldLogSQL(false), _currConn(0), _asyncAllowed(false), _logger(nullptr), _numAsyncWriters(1), _maxStatementBytes(0), _delayMinBatch(1), _delayMaxLingerMS(0), _groupMaxOps(1), _groupMaxMS(0),
+	_poolMin(1), _poolMax(1), _poolMinCfg(0), _poolMaxCfg(0), _poolGrowWaitMS(10), _poolHealthCheckSec(30), 
+	_poolAcquired(0), _poolWaited(0), _poolWaitedMS(0), _poolMaxWaitMS(0), _poolWindowWaited(0), _poolWindowWaitedMS(0)
 {
+	_poolActive = 0;
+	for (size_t i=0; i<MAX_POOL_CONNS; i++)
+		_poolUsers[i] = 0;
 }
 
 ConcreteDatabase::~ConcreteDatabase()
@@ -60,16 +65,22 @@ bool ConcreteDatabase::initialise(Poco::Logger& dbLogger, const string& infoStri
 
 	//create DB connections
 
-	//setup connection pool size
-	size_t poolSize = nConns;
+	//setup connection pool size, it starts at the minimum
+	size_t poolSize = std::max(nConns,_poolMinCfg);
 	if(poolSize < MIN_CONNECTION_POOL_SIZE)
 		poolSize = MIN_CONNECTION_POOL_SIZE;
-	else if(poolSize > MAX_CONNECTION_POOL_SIZE)
-		poolSize = MAX_CONNECTION_POOL_SIZE;
+	else if(poolSize > MAX_POOL_CONNS)
+		poolSize = MAX_POOL_CONNS;
+
+	_poolMin = poolSize;
+	_poolMax = std::min(std::max(_poolMaxCfg,poolSize),size_t(MAX_POOL_CONNS));
+	_infoString = infoString;
+
+	size_t numWriters = std::min(std::max(_numAsyncWriters,size_t(1)),size_t(MAX_POOL_CONNS));
 
 	//initialize and connect all the connections
 	_queryConns.clear();
-	_queryConns.reserve(poolSize);
+	_queryConns.reserve(MAX_POOL_CONNS);
 	try
 	{
 		//create and initialize the sync connection pool
@@ -84,6 +95,16 @@ bool ConcreteDatabase::initialise(Poco::Logger& dbLogger, const string& infoStri
 		//create and initialize connection for async requests
 		_asyncConn = createConnection(infoString);
 		_asyncConn->connect();
+
+		//and the extra async writers
+		_shardConns.clear();
+		for (size_t i=1; i<numWriters; i++)
+		{
+			unique_ptr<SqlConnection> pConn = createConnection(infoString);
+			pConn->connect();
+
+			_shardConns.push_back(pConn.release());
+		}
 	}
 	catch(const SqlConnection::SqlException& e)
 	{
@@ -92,6 +113,20 @@ bool ConcreteDatabase::initialise(Poco::Logger& dbLogger, const string& infoStri
 	}
 
 	_resultQueue.clear();
+	_maxStatementBytes = 0;
+
+	_poolActive = _queryConns.size();
+	{
+		Poco::FastMutex::ScopedLock guard(_poolStatsLock);
+		_poolAcquired = _poolWaited = _poolWaitedMS = 0;
+		_poolWindowWaited = _poolWindowWaitedMS = 0;
+		_poolMaxWaitMS = 0;
+	}
+	if (_poolMax > _poolMin || _poolHealthCheckSec > 0)
+	{
+		_poolMaintainer.reset(new PoolMaintainer(*this));
+		_poolMaintainer->start();
+	}
 
 	initDelayThread();
 	return true;
@@ -99,40 +134,73 @@ bool ConcreteDatabase::initialise(Poco::Logger& dbLogger, const string& infoStri
 
 void ConcreteDatabase::stopServer()
 {
+	if (_poolMaintainer)
+	{
+		_poolMaintainer->stop();
+		_poolMaintainer.reset();
+	}
 	haltDelayThread();
+	_poolActive = 0;
 
 	_resultQueue.clear();
 	_asyncConn.reset();
+	_shardConns.clear();
 	_queryConns.clear();
 }
 
-unique_ptr<SqlDelayThread> ConcreteDatabase::createDelayThread()
+unique_ptr<SqlDelayThread> ConcreteDatabase::createDelayThread(SqlConnection& conn)
 {
-	poco_assert(_asyncConn);
-	return unique_ptr<SqlDelayThread>(new SqlDelayThread(*this, *_asyncConn));
+	unique_ptr<SqlDelayThread> delayThread(new SqlDelayThread(*this, conn, getLogger()));
+	delayThread->setPolicy(_delayMinBatch, _delayMaxLingerMS);
+	delayThread->setGroupCommit(_groupMaxOps, _groupMaxMS);
+	return delayThread;
+}
+
+void ConcreteDatabase::setDelayPolicy( size_t minBatch, UInt32 maxLingerMS )
+{
+	_delayMinBatch = minBatch;
+	_delayMaxLingerMS = maxLingerMS;
+	for (size_t i=0; i<_delayRunners.size(); i++)
+		_delayRunners[i].body().setPolicy(minBatch, maxLingerMS);
+}
+
+void ConcreteDatabase::setGroupCommit( size_t maxOps, UInt32 maxMS )
+{
+	_groupMaxOps = maxOps;
+	_groupMaxMS = maxMS;
+	for (size_t i=0; i<_delayRunners.size(); i++)
+		_delayRunners[i].body().setGroupCommit(maxOps, maxMS);
 }
 
 #include <Poco/Thread.h>
 
 void ConcreteDatabase::initDelayThread()
 {
-	if (_delayRunner)
+	if (!_delayRunners.empty())
 		haltDelayThread();
 
-	poco_assert_dbg(!_delayRunner);
+	poco_assert(_asyncConn);
+
+	//New delay thread for delay execute, and one for each extra writer
+	_delayRunners.push_back(new DelayThreadRunnable(createDelayThread(*_asyncConn), "SQL Delay Thread"));
+	for (size_t i=0; i<_shardConns.size(); i++)
+	{
+		string name = "SQL Delay Thread " + boost::lexical_cast<string>(i+1);
+		_delayRunners.push_back(new DelayThreadRunnable(createDelayThread(_shardConns[i]), name));
+	}
 
-	//New delay thread for delay execute
-	_delayRunner.reset(new DelayThreadRunnable(createDelayThread()));
-	_delayRunner->start();
+	for (size_t i=0; i<_delayRunners.size(); i++)
+		_delayRunners[i].start();
 }
 
 void ConcreteDatabase::haltDelayThread()
 {
-	if (!_delayRunner) 
+	if (_delayRunners.empty())
 		return;
 
-	_delayRunner->stop();
-	_delayRunner.reset();
+	for (size_t i=0; i<_delayRunners.size(); i++)
+		_delayRunners[i].stop();
+	_delayRunners.clear();
 }
 
 void ConcreteDatabase::threadEnter()
@@ -147,16 +215,14 @@ void ConcreteDatabase::threadExit()
 
 unique_ptr<QueryResult> ConcreteDatabase::query( const char* sql )
 {
-	SqlConnection& conn = getQueryConnection();
-	SqlConnection::Lock guard(conn);
-	return Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[sql](SqlConnection& c){ return c.query(sql); })(conn,"Query",[sql](){return sql;});
+	PooledConn conn(*this);
+	return Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[sql](SqlConnection& c){ return c.query(sql); })(*conn,"Query",[sql](){return sql;});
 }
 
 unique_ptr<QueryNamedResult> ConcreteDatabase::namedQuery( const char* sql )
 {
-	SqlConnection& conn = getQueryConnection();
-	SqlConnection::Lock guard(conn);
-	return Retry::SqlOp< unique_ptr<QueryNamedResult> >(getLogger(),[sql](SqlConnection& c){ return c.namedQuery(sql); })(conn,"QueryNamed",[sql](){return sql;});
+	PooledConn conn(*this);
+	return Retry::SqlOp< unique_ptr<QueryNamedResult> >(getLogger(),[sql](SqlConnection& c){ return c.namedQuery(sql); })(*conn,"QueryNamed",[sql](){return sql;});
 }
 
 bool ConcreteDatabase::directExecute( const char* sql )
@@ -189,18 +255,280 @@ std::string ConcreteDatabase::escape(const std::string& str) const
 		return str;
 }
 
-SqlConnection& ConcreteDatabase::getQueryConnection()
+size_t ConcreteDatabase::acquireQueryConnection()
+{
+	UInt32 startTime = GlobalTimer::getMSTime();
+	for (;;)
+	{
+		size_t active = _poolActive;
+		poco_assert(active > 0);
+
+		//an idle connection if there is one, starting somewhere else every time to spread the load
+		size_t first = static_cast<size_t>(_currConn++) % active;
+		size_t idx = active;
+		for (size_t i=0; i<active; i++)
+		{
+			size_t curr = (first+i) % active;
+			if (_queryConns[curr].tryLock())
+			{
+				idx = curr;
+				_poolUsers[idx]++;
+				break;
+			}
+		}
+
+		//otherwise queue up on the one with the fewest users
+		bool waited = false;
+		if (idx >= active)
+		{
+			idx = first;
+			for (size_t i=0; i<active; i++)
+			{
+				if (_poolUsers[i] < _poolUsers[idx])
+					idx = i;
+			}
+			_poolUsers[idx]++;
+			_queryConns[idx].lock();
+			waited = true;
+		}
+
+		//parked while we were getting it
+		if (idx >= _poolActive)
+		{
+			releaseQueryConnection(idx);
+			continue;
+		}
+
+		UInt32 waitMS = waited ? GlobalTimer::getMSTimeDiff(startTime,GlobalTimer::getMSTime()) : 0;
+		{
+			Poco::FastMutex::ScopedLock guard(_poolStatsLock);
+			_poolAcquired++;
+			if (waited)
+			{
+				_poolWaited++;
+				_poolWaitedMS += waitMS;
+				_poolWindowWaited++;
+				_poolWindowWaitedMS += waitMS;
+				_poolMaxWaitMS = std::max(_poolMaxWaitMS,waitMS);
+			}
+		}
+		return idx;
+	}
+}
+
+void ConcreteDatabase::releaseQueryConnection( size_t idx )
+{
+	_poolUsers[idx]--;
+	_queryConns[idx].unlock();
+}
+
+void ConcreteDatabase::setPoolPolicy( size_t minConns, size_t maxConns, UInt32 growWaitMS, UInt32 healthCheckSec )
+{
+	_poolMinCfg = minConns;
+	_poolMaxCfg = maxConns;
+	_poolGrowWaitMS = growWaitMS;
+	_poolHealthCheckSec = healthCheckSec;
+}
+
+ConcreteDatabase::PoolStats ConcreteDatabase::getPoolStats() const
+{
+	PoolStats stats = { 0, 0, 0, 0, 0, 0 };
+	stats.active = _poolActive;
+	for (size_t i=0; i<stats.active; i++)
+	{
+		if (_poolUsers[i] > 0)
+			stats.busy++;
+	}
+
+	Poco::FastMutex::ScopedLock guard(_poolStatsLock);
+	stats.acquired = _poolAcquired;
+	stats.waited = _poolWaited;
+	if (_poolWaited > 0)
+		stats.avgWaitMS = double(_poolWaitedMS) / double(_poolWaited);
+	stats.maxWaitMS = _poolMaxWaitMS;
+	return stats;
+}
+
+namespace
+{
+	const UInt32 POOL_TICK_MS = 1000;
+	//this long without anyone waiting for a connection and one gets parked
+	const UInt32 POOL_IDLE_SHRINK_MS = 60*1000;
+	const UInt32 POOL_LOG_MS = 60*1000;
+};
+
+void ConcreteDatabase::PoolMaintainer::run()
+{
+	_db.threadEnter();
+
+	UInt32 lastWait = GlobalTimer::getMSTime();
+	UInt32 lastHealth = lastWait;
+	UInt32 lastLog = lastWait;
+	while (!_stopEvent.tryWait(POOL_TICK_MS))
+	{
+		UInt64 waited, waitedMS;
+		{
+			Poco::FastMutex::ScopedLock guard(_db._poolStatsLock);
+			waited = _db._poolWindowWaited;
+			waitedMS = _db._poolWindowWaitedMS;
+			_db._poolWindowWaited = _db._poolWindowWaitedMS = 0;
+		}
+
+		UInt32 now = GlobalTimer::getMSTime();
+		if (waited > 0)
+			lastWait = now;
+
+		//queries are queueing for connections, open another one
+		if (waited > 0 && waitedMS >= waited * _db._poolGrowWaitMS)
+			_db.growPool();
+		//one at a time, each after a full idle period
+		else if (GlobalTimer::getMSTimeDiff(lastWait,now) >= POOL_IDLE_SHRINK_MS)
+		{
+			_db.shrinkPool();
+			lastWait = now;
+		}
+
+		if (_db._poolHealthCheckSec > 0 && GlobalTimer::getMSTimeDiff(lastHealth,now) >= _db._poolHealthCheckSec*1000)
+		{
+			_db.checkPoolHealth();
+			lastHealth = GlobalTimer::getMSTime();
+		}
+
+		if (GlobalTimer::getMSTimeDiff(lastLog,now) >= POOL_LOG_MS)
+		{
+			_db.logPoolStats();
+			lastLog = now;
+		}
+	}
+
+	_db.threadExit();
+}
+
+bool ConcreteDatabase::growPool()
 {
-	poco_assert(_queryConns.size() > 0);
-	size_t nCount = _currConn++;
-	return _queryConns[nCount % _queryConns.size()];
+	//only the maintainer resizes, so this needs no lock of its own
+	size_t active = _poolActive;
+	if (active >= _poolMax)
+		return false;
+
+	try
+	{
+		if (active < _queryConns.size())
+		{
+			//bring back a parked one
+			SqlConnection& conn = _queryConns[active];
+			SqlConnection::Lock guard(conn);
+			conn.connect();
+		}
+		else
+		{
+			unique_ptr<SqlConnection> pConn = createConnection(_infoString);
+			pConn->connect();
+
+			//within the reserved capacity, so nobody's connection moves
+			_queryConns.push_back(pConn.release());
+		}
+	}
+	catch(const SqlConnection::SqlException& e)
+	{
+		e.toLog(getLogger());
+		return false;
+	}
+
+	_poolActive = active+1;
+	getLogger().information(Poco::format("Connection pool grown to %z (max %z)",active+1,_poolMax));
+	return true;
 }
 
-SqlConnection& ConcreteDatabase::getAsyncConnection()
+bool ConcreteDatabase::shrinkPool()
 {
+	size_t active = _poolActive;
+	if (active <= _poolMin)
+		return false;
+
+	//no new users from here on, then wait out the current ones
+	_poolActive = active-1;
+	SqlConnection& conn = _queryConns[active-1];
+	{
+		SqlConnection::Lock guard(conn);
+		conn.disconnect();
+	}
+
+	getLogger().information(Poco::format("Connection pool shrunk to %z (min %z)",active-1,_poolMin));
+	return true;
+}
+
+void ConcreteDatabase::checkPoolHealth()
+{
+	const char* sql = "SELECT 1";
+	size_t numAsync = _shardConns.size()+1;
+	size_t active = _poolActive;
+	for (size_t i=0; i<numAsync+active; i++)
+	{
+		SqlConnection& conn = (i < numAsync) ? getAsyncConnection(i) : _queryConns[i-numAsync];
+		//busy ones are evidently alive, and we shouldn't hold anybody up
+		if (!conn.tryLock())
+			continue;
+
+		SqlConnection::Lock guard(conn,SqlConnection::Lock::ADOPT);
+		//reconnects if the server dropped it, so the next request doesn't have to
+		auto qry = Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[sql](SqlConnection& c){ return c.query(sql); })(conn,"HealthCheck");
+		if (!qry)
+			getLogger().warning("Connection " + boost::lexical_cast<string>(i) + " failed its health check");
+	}
+}
+
+void ConcreteDatabase::logPoolStats()
+{
+	if (!getLogger().debug())
+		return;
+
+	PoolStats stats = getPoolStats();
+	{
+		Poco::FastMutex::ScopedLock guard(_poolStatsLock);
+		_poolMaxWaitMS = 0;
+	}
+
+	getLogger().debug(Poco::format("Connection pool: %z active, %z busy, %Lu acquired, %Lu waited (avg %.1fms, max %ums)",
+		stats.active,stats.busy,stats.acquired,stats.waited,stats.avgWaitMS,stats.maxWaitMS));
+}
+
+SqlConnection& ConcreteDatabase::getAsyncConnection(size_t shard)
+{
+	if (shard > 0 && shard <= _shardConns.size())
+		return _shardConns[shard-1];
+
 	return *_asyncConn;
 }
 
+size_t ConcreteDatabase::asyncShardOf( Int64 shardKey ) const
+{
+	size_t numShards = _shardConns.size()+1;
+	if (numShards < 2)
+		return 0;
+
+	return static_cast<size_t>(static_cast<UInt64>(shardKey) % numShards);
+}
+
+UInt64 ConcreteDatabase::asyncWriteTicket( Int64 shardKey ) const
+{
+	//without delay threads writes run directly, so they're done by the time anyone asks
+	size_t shard = asyncShardOf(shardKey);
+	if (!_asyncAllowed || shard >= _delayRunners.size())
+		return 0;
+
+	return _delayRunners[shard].body().queuedOps();
+}
+
+bool ConcreteDatabase::asyncWriteDone( Int64 shardKey, UInt64 ticket ) const
+{
+	size_t shard = asyncShardOf(shardKey);
+	if (shard >= _delayRunners.size())
+		return true;
+
+	return _delayRunners[shard].body().doneOps() >= ticket;
+}
+
 bool ConcreteDatabase::checkConnections()
 {
 	const char* sql = "SELECT 1";
@@ -213,17 +541,18 @@ bool ConcreteDatabase::checkConnections()
 		return true;
 	};
 
-	//check async conn
+	//check async conns
+	for (size_t i=0; i<=_shardConns.size(); i++)
 	{
-		SqlConnection& conn = getAsyncConnection();
+		SqlConnection& conn = getAsyncConnection(i);
 		SqlConnection::Lock guard(conn);
 		auto qry = Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[sql](SqlConnection& c){ return c.query(sql); })(conn,"CheckAsync");
 		if (!checkFunc(qry.get()))
 			return false;
 	}
 
-	//check all sync conns
-	for (size_t i=0; i<_queryConns.size(); i++)
+	//check all sync conns, parked ones aren't connected
+	for (size_t i=0; i<_poolActive; i++)
 	{
 		SqlConnection& conn = _queryConns[i];
 		SqlConnection::Lock guard(conn);
@@ -294,6 +623,34 @@ unique_ptr<QueryResult> ConcreteDatabase::queryParams(const char* format,...)
 	return query(szQuery);
 }
 
+unique_ptr<QueryResult> ConcreteDatabase::queryStreamed( const char* sql )
+{
+	unique_ptr<PooledConn> conn(new PooledConn(*this));
+	//retrying is only safe up to the first row, so this covers just the query itself
+	auto res = Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[sql](SqlConnection& c){ return c.queryStreamed(sql); })(**conn,"QueryStreamed",[sql](){return sql;});
+	if (!res)
+		return nullptr;
+
+	return unique_ptr<QueryResult>(new StreamedResult(std::move(conn), std::move(res)));
+}
+
+unique_ptr<QueryResult> ConcreteDatabase::queryParamsStreamed(const char* format,...)
+{
+	if (!format) 
+		return nullptr;
+
+	va_list ap;
+	char szQuery[MAX_QUERY_LEN];
+	va_start(ap, format);
+	int res = vsnprintf( szQuery, MAX_QUERY_LEN, format, ap );
+	va_end(ap);
+
+	if (!checkFmtError(res,format))
+		return nullptr;
+
+	return queryStreamed(szQuery);
+}
+
 unique_ptr<QueryNamedResult> ConcreteDatabase::namedQueryParams(const char* format,...)
 {
 	if (!format)
@@ -312,6 +669,37 @@ unique_ptr<QueryNamedResult> ConcreteDatabase::namedQueryParams(const char* form
 }
 
 bool ConcreteDatabase::execute(const char* sql)
+{
+	return executeOnShard(sql, 0);
+}
+
+bool ConcreteDatabase::executeKeyed( Int64 shardKey, const char* sql )
+{
+	return executeOnShard(sql, asyncShardOf(shardKey));
+}
+
+bool ConcreteDatabase::executeKeyedSplit( Int64 shardKey, const char* sql, const std::vector<std::string>& fallbacks )
+{
+	if (!_asyncConn)
+		return false;
+
+	SqlOperation* op = new SqlSplitRequest(sql, fallbacks);
+	SqlTransaction* pTrans = _transStorage->get();
+	if(pTrans)
+		pTrans->queueOperation(op);
+	else if(!_asyncAllowed)
+	{
+		bool exRes = op->execute(getAsyncConnection());
+		op->onRemove();
+		return exRes;
+	}
+	else
+		_delayRunners[asyncShardOf(shardKey)].queueOperation(op);
+
+	return true;
+}
+
+bool ConcreteDatabase::executeOnShard( const char* sql, size_t shard )
 {
 	if (!_asyncConn)
 		return false;
@@ -320,7 +708,7 @@ bool ConcreteDatabase::execute(const char* sql)
 	if(pTrans)
 	{
 		//add SQL request to trans queue
-		pTrans->queueOperation(new SqlPlainRequest(sql));
+		pTrans->queueOperation(_opPool.plainRequest(sql));
 	}
 	else
 	{
@@ -329,7 +717,7 @@ bool ConcreteDatabase::execute(const char* sql)
 			return directExecute(sql);
 
 		// Simple sql statement
-		_delayRunner->queueOperation(new SqlPlainRequest(sql));
+		_delayRunners[shard].queueOperation(_opPool.plainRequest(sql));
 	}
 
 	return true;
@@ -420,7 +808,7 @@ bool ConcreteDatabase::transactionCommit()
 		return transactionCommitDirect();
 
 	//add SqlTransaction to the async queue
-	_delayRunner->queueOperation(_transStorage->detach());
+	_delayRunners[0].queueOperation(_transStorage->detach());
 	return true;
 }
 
@@ -456,7 +844,7 @@ bool ConcreteDatabase::transactionRollback()
 	return true;
 }
 
-bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters& params )
+bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters& params, size_t shard )
 {
 	if (!_asyncConn)
 		return false;
@@ -465,7 +853,7 @@ bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters&
 	if(pTrans)
 	{
 		//add SQL request to trans queue
-		pTrans->queueOperation(new SqlPreparedRequest(id, params));
+		pTrans->queueOperation(_opPool.preparedRequest(id, params));
 	}
 	else
 	{
@@ -474,7 +862,7 @@ bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters&
 			return directExecuteStmt(id, params);
 
 		// Simple sql statement
-		_delayRunner->queueOperation(new SqlPreparedRequest(id, params));
+		_delayRunners[shard].queueOperation(_opPool.preparedRequest(id, params));
 	}
 
 	return true;
@@ -489,6 +877,54 @@ bool ConcreteDatabase::directExecuteStmt( const SqlStatementID& id, SqlStmtParam
 	return Retry::SqlOp<bool>(getLogger(),[&](SqlConnection& c){ return c.executeStmt(id, params); })(conn,"DirectStmtExec",[&](){ return conn.getStmt(id)->getSqlString(true); });
 }
 
+unique_ptr<QueryResult> ConcreteDatabase::queryStmt( const SqlStatementID& id, SqlStmtParameters& params )
+{
+	PooledConn conn(*this);
+	return Retry::SqlOp< unique_ptr<QueryResult> >(getLogger(),[&](SqlConnection& c){ return c.queryStmt(id, params); })(*conn,"StmtQuery",[&](){ return conn->getStmt(id)->getSqlString(true); });
+}
+
+bool ConcreteDatabase::executeBulkStmt( const SqlStatementID& id, vector<SqlStmtParameters>& rows, size_t shard )
+{
+	if (rows.size() == 1)
+		return executeStmt(id, rows[0], shard);
+
+	bool allOk = true;
+	SqlBulkBuilder builder;
+	if (!builder.parse(getStmtString(id.getId()), id.numArgs()))
+	{
+		//not a shape we can merge, so it's a round trip per row
+		for (size_t i=0; i<rows.size(); i++)
+			allOk = executeStmt(id, rows[i], shard) && allOk;
+
+		return allOk;
+	}
+
+	vector<string> statements;
+	builder.build(rows, maxStatementBytes(), *this, statements);
+	for (size_t i=0; i<statements.size(); i++)
+		allOk = executeOnShard(statements[i].c_str(), shard) && allOk;
+
+	return allOk;
+}
+
+size_t ConcreteDatabase::maxStatementBytes()
+{
+	if (_maxStatementBytes == 0)
+	{
+		size_t maxBytes = 1024*1024;
+		auto packetRes = query("select @@max_allowed_packet");
+		if (packetRes && packetRes->fetchRow())
+		{
+			//leave room for the protocol
+			UInt64 maxPacket = packetRes->at(0).getUInt64();
+			if (maxPacket > 4096)
+				maxBytes = static_cast<size_t>(std::min(maxPacket - 4096, UInt64(maxBytes)));
+		}
+		_maxStatementBytes = maxBytes;
+	}
+	return _maxStatementBytes;
+}
+
 unique_ptr<SqlStatement> ConcreteDatabase::makeStatement( SqlStatementID& index, std::string sqlText )
 {
 	//initialize the statement if its not (or missing in the registry)
@@ -514,7 +950,7 @@ const char* ConcreteDatabase::getStmtString(UInt32 stmtId) const
 
 bool ConcreteDatabase::doDelay( const char* sql, QueryCallback callback )
 {
-	return _delayRunner->queueOperation(new SqlQuery(sql, callback, _resultQueue));
+	return _delayRunners[0].queueOperation(new SqlQuery(sql, callback, _resultQueue));
 }
 
 bool ConcreteDatabase::checkFmtError( int res, const char* format ) const
@@ -536,6 +972,18 @@ SqlTransaction* ConcreteDatabase::TransHelper::init()
 	return get();
 }
 
+ConcreteDatabase::PreparedStmtRegistry::PreparedStmtRegistry() : _nextId(0)
+{
+	for (size_t i=0; i<MAX_CHUNKS; i++)
+		_chunks[i] = nullptr;
+}
+
+ConcreteDatabase::PreparedStmtRegistry::~PreparedStmtRegistry()
+{
+	for (size_t i=0; i<MAX_CHUNKS; i++)
+		delete static_cast<Chunk*>(_chunks[i]);
+}
+
 void ConcreteDatabase::PreparedStmtRegistry::insertStmt(UInt32 theId, std::string fmt)
 {
 	RegistryGuardType _guard(_lock);
@@ -544,8 +992,21 @@ void ConcreteDatabase::PreparedStmtRegistry::insertStmt(UInt32 theId, std::strin
 
 void ConcreteDatabase::PreparedStmtRegistry::_insertStmt( UInt32 theId, std::string fmt )
 {
+	if (theId < 1 || (theId-1) / CHUNK_SIZE >= MAX_CHUNKS)
+		poco_bugcheck_msg("Prepared statement id out of registry range");
+
+	size_t idx = theId-1;
+	Chunk* chunk = _chunks[idx / CHUNK_SIZE];
+	if (!chunk)
+	{
+		chunk = new Chunk();
+		_chunks[idx / CHUNK_SIZE] = chunk; //release, readers see the nulled slots
+	}
+
 	StatementMap::const_iterator it = _stringMap.insert(std::make_pair(std::move(fmt),theId)).first;
-	_idMap.insert(std::make_pair(theId,it->first.c_str()));
+	//first one wins, same as the map this replaced
+	if (chunk->slots[idx % CHUNK_SIZE] == nullptr)
+		chunk->slots[idx % CHUNK_SIZE] = it->first.c_str(); //release, publishes the string
 }
 
 UInt32 ConcreteDatabase::PreparedStmtRegistry::getStmtId( std::string fmt )
@@ -570,10 +1031,14 @@ const char* ConcreteDatabase::PreparedStmtRegistry::getStmtString( UInt32 stmtId
 	if(stmtId == 0)
 		return nullptr;
 
-	RegistryGuardType _guard(_lock);
-	IdMap::const_iterator it = _idMap.find(stmtId);
-	if (it != _idMap.end())
-		return it->second;
+	size_t idx = stmtId-1;
+	if (idx / CHUNK_SIZE >= MAX_CHUNKS)
+		return nullptr;
+
+	//acquire loads, pair with the release stores in _insertStmt
+	const Chunk* chunk = _chunks[idx / CHUNK_SIZE];
+	if (!chunk)
+		return nullptr;
 
-	return nullptr;
+	return chunk->slots[idx % CHUNK_SIZE];
 }
@@ -22,9 +22,12 @@
 #include <Poco/Thread.h>
 #include <Poco/AtomicCounter.h>
 #include <Poco/ThreadLocal.h>
+#include <Poco/Event.h>
+#include <Poco/Runnable.h>
 
 #include <boost/unordered_map.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <tbb/atomic.h>
 
 #include "Database/Database.h"
 #include "Database/SqlStatement.h"
@@ -51,11 +54,20 @@ public:
 	unique_ptr<QueryResult> queryParams(const char* format,...) override;
 	unique_ptr<QueryNamedResult> namedQueryParams(const char* format,...) override;
 
+	unique_ptr<QueryResult> queryStreamed(const char* sql) override;
+	unique_ptr<QueryResult> queryParamsStreamed(const char* format,...) override;
+
 	bool directExecute(const char* sql) override;
 	bool directExecuteParams(const char* format,...) override;
 
 	bool execute(const char* sql) override;
 	bool executeParams(const char* format,...) override;
+	bool executeKeyed(Int64 shardKey, const char* sql) override;
+	bool executeKeyedSplit(Int64 shardKey, const char* sql, const std::vector<std::string>& fallbacks) override;
+	size_t asyncShardOf(Int64 shardKey) const override;
+	UInt64 asyncWriteTicket(Int64 shardKey) const override;
+	bool asyncWriteDone(Int64 shardKey, UInt64 ticket) const override;
+	size_t maxStatementBytes() override;
 
 	bool asyncQuery(QueryCallback::FuncType func, const char* sql) override;
 	bool asyncQueryParams(QueryCallback::FuncType func, const char* format, ...) override;
@@ -83,18 +95,25 @@ public:
 
 	//Call this once you're out of global constructor code/DLLMain
 	void allowAsyncOperations() override { _asyncAllowed = true; }
+	void setAsyncWriters(size_t numWriters) override { _numAsyncWriters = numWriters; }
+
+	void setDelayPolicy(size_t minBatch, UInt32 maxLingerMS) override;
+	void setGroupCommit(size_t maxOps, UInt32 maxMS) override;
+
+	void setPoolPolicy(size_t minConns, size_t maxConns, UInt32 growWaitMS, UInt32 healthCheckSec) override;
 protected:
 	ConcreteDatabase();
 
 	bool checkFmtError(int res, const char* format) const;
 	bool doDelay(const char* sql, QueryCallback callback);
+	bool executeOnShard(const char* sql, size_t shard);
 
 	void stopServer();
 
 	//factory method to create SqlConnection objects
 	virtual unique_ptr<SqlConnection> createConnection(const std::string& infoString) = 0;
 	//factory method to create SqlDelayThread objects
-	virtual unique_ptr<SqlDelayThread> createDelayThread();
+	virtual unique_ptr<SqlDelayThread> createDelayThread(SqlConnection& conn);
 
 	class TransHelper
 	{
@@ -117,32 +136,135 @@ protected:
 		unique_ptr<SqlTransaction> _trans;
 	};
 
+	//recycled async requests, declared first so it outlives everything that can still hold one
+	SqlOpPool _opPool;
+
 	//per-thread based storage for SqlTransaction object initialization - no locking is required
 	typedef Poco::ThreadLocal<TransHelper> DBTransHelperTSS;
 	DBTransHelperTSS _transStorage;
 
 	//DB connections
 
-	//round-robin connection selection
-	SqlConnection& getQueryConnection();
-	//for now return one single connection for async requests
-	SqlConnection& getAsyncConnection();
+	enum { MAX_POOL_CONNS = 16 };
+
+	//locks an idle pool connection, or queues on the least busy one, returns its index
+	size_t acquireQueryConnection();
+	void releaseQueryConnection(size_t idx);
+
+	//a locked pool connection, handed back when it goes out of scope
+	class PooledConn : public boost::noncopyable
+	{
+	public:
+		PooledConn(ConcreteDatabase& db) : _db(db), _idx(db.acquireQueryConnection()) {}
+		~PooledConn() { _db.releaseQueryConnection(_idx); }
+
+		SqlConnection& operator*() const { return _db._queryConns[_idx]; }
+		SqlConnection* operator->() const { return &_db._queryConns[_idx]; }
+	private:
+		ConcreteDatabase& _db;
+		size_t _idx;
+	};
+
+	//holds on to its pool connection until the rows run out, or until it's destroyed
+	class StreamedResult : public QueryResult
+	{
+	public:
+		StreamedResult(unique_ptr<PooledConn> conn, unique_ptr<QueryResult> res) : _conn(std::move(conn)), _res(std::move(res)) {}
+		//the result lets go of the connection before it's handed back
+		~StreamedResult() { _res.reset(); }
+
+		bool fetchRow() override
+		{
+			if (_res->fetchRow())
+				return true;
+
+			//the result is finished by now, someone else can have the connection
+			_conn.reset();
+			return false;
+		}
+		const vector<Field>& fields() const override { return _res->fields(); }
+
+		size_t numFields() const override { return _res->numFields(); }
+		UInt64 numRows() const override { return _res->numRows(); }
+		bool incomplete() const override { return _res->incomplete(); }
+	private:
+		unique_ptr<PooledConn> _conn;
+		unique_ptr<QueryResult> _res;
+	};
+
+	//connection of an async writer, the first one also serves direct executes and transactions
+	SqlConnection& getAsyncConnection(size_t shard = 0);
 
 	friend class SqlStatementImpl;
 	//PREPARED STATEMENT API
 	//query function for prepared statements
-	bool executeStmt(const SqlStatementID& id, SqlStmtParameters& params);
+	bool executeStmt(const SqlStatementID& id, SqlStmtParameters& params, size_t shard = 0);
 	bool directExecuteStmt(const SqlStatementID& id, SqlStmtParameters& params);
+	unique_ptr<QueryResult> queryStmt(const SqlStatementID& id, SqlStmtParameters& params);
+	bool executeBulkStmt(const SqlStatementID& id, vector<SqlStmtParameters>& rows, size_t shard);
 
 	//connection helper counters
-	Poco::AtomicCounter _currConn;  //counter for connection selection
+	Poco::AtomicCounter _currConn;  //where the search for an idle connection starts
 
 	//pool of connections for general queries
+	//reserved up front and only ever appended to, so connections don't move while in use
 	typedef boost::ptr_vector<SqlConnection> SqlConnectionContainer;
 	SqlConnectionContainer _queryConns;
+	//the ones from here on are parked (disconnected) until the pool grows again
+	tbb::atomic<size_t> _poolActive;
+	//holding or waiting for each connection
+	tbb::atomic<int> _poolUsers[MAX_POOL_CONNS];
+	size_t _poolMin, _poolMax;
+	//as configured, 0 means whatever initialise was asked for
+	size_t _poolMinCfg, _poolMaxCfg;
+	UInt32 _poolGrowWaitMS, _poolHealthCheckSec;
+	std::string _infoString;
+
+	mutable Poco::FastMutex _poolStatsLock;
+	UInt64 _poolAcquired, _poolWaited, _poolWaitedMS;
+	UInt32 _poolMaxWaitMS;
+	//since the maintainer last looked
+	UInt64 _poolWindowWaited, _poolWindowWaitedMS;
+
+	//pool sizing and health checks, off the request path
+	class PoolMaintainer : public Poco::Runnable
+	{
+	public:
+		PoolMaintainer(ConcreteDatabase& db) : _db(db), _thread("SQL Pool Maintainer"), _stopEvent(false) {}
+		void start() { _stopEvent.reset(); _thread.start(*this); }
+		void stop() { _stopEvent.set(); if (_thread.isRunning()) _thread.join(); }
+		void run() override;
+	private:
+		ConcreteDatabase& _db;
+		Poco::Thread _thread;
+		Poco::Event _stopEvent;
+	};
+	unique_ptr<PoolMaintainer> _poolMaintainer;
+
+	bool growPool();
+	bool shrinkPool();
+	void checkPoolHealth();
+
+	//logged at debug by the pool maintainer
+	struct PoolStats
+	{
+		size_t active;
+		size_t busy;
+		UInt64 acquired;
+		UInt64 waited; //acquisitions that found no idle connection
+		double avgWaitMS; //of the ones that waited
+		UInt32 maxWaitMS; //since the last stats log
+	};
+	PoolStats getPoolStats() const;
+	void logPoolStats();
 
 	//only one single DB connection for transactions
 	unique_ptr<SqlConnection> _asyncConn;
+	//connections of the additional async writers
+	SqlConnectionContainer _shardConns;
+	size_t _numAsyncWriters;
+	//0 until asked for
+	size_t _maxStatementBytes;
 
 	//Transaction queues from diff. threads
 	SqlResultQueue _resultQueue;
@@ -150,8 +272,8 @@ protected:
 	class DelayThreadRunnable : public Poco::Thread
 	{
 	public:
-		DelayThreadRunnable(unique_ptr<SqlDelayThread> body) 
-			: Poco::Thread("SQL Delay Thread"), _body(std::move(body)) {} 
+		DelayThreadRunnable(unique_ptr<SqlDelayThread> body, const std::string& name) 
+			: Poco::Thread(name), _body(std::move(body)) {} 
 		void start() { Poco::Thread::start(*_body); }
 		void stop() 
 		{
@@ -159,19 +281,27 @@ protected:
 			Poco::Thread::join();	//wait for thread to finish
 		}
 		bool queueOperation(SqlOperation* sql) { return _body->queueOperation(sql); }
+		SqlDelayThread& body() const { return *_body; }
 	private:
 		unique_ptr<SqlDelayThread> _body;
 	};
-	unique_ptr<DelayThreadRunnable>	_delayRunner;
+	//one per async writer, the first one gets all unkeyed operations
+	boost::ptr_vector<DelayThreadRunnable> _delayRunners;
+	size_t _delayMinBatch;
+	UInt32 _delayMaxLingerMS;
+	size_t _groupMaxOps;
+	UInt32 _groupMaxMS;
 
 	//To prevent threading before they work properly
 	bool _asyncAllowed;
 
 	//PREPARED STATEMENT REGISTRY
+	//append-only, so lookups by id read published slots without taking the lock
 	class PreparedStmtRegistry
 	{
 	public:
-		PreparedStmtRegistry() : _nextId(0) {}
+		PreparedStmtRegistry();
+		~PreparedStmtRegistry();
 
 		//manually insert a new record
 		void insertStmt(UInt32 theId, std::string fmt);
@@ -180,18 +310,26 @@ protected:
 		//get sql for id
 		const char* getStmtString(UInt32 stmtId) const;
 		//is id defined ?
-		bool idDefined(UInt32 theId) const { return (_idMap.count(theId) > 0); }
+		bool idDefined(UInt32 theId) const { return (getStmtString(theId) != nullptr); }
 	private:
 		void _insertStmt(UInt32 theId, std::string fmt);
 
 		typedef Poco::FastMutex RegistryLockType;
 		typedef Poco::ScopedLock<RegistryLockType> RegistryGuardType;
-		mutable RegistryLockType _lock; //guards _map
+		mutable RegistryLockType _lock; //guards _stringMap, _nextId and chunk allocation
 
+		//node based, so the key strings never move and slots can point at them
 		typedef boost::unordered_map<std::string, UInt32> StatementMap;
 		StatementMap _stringMap;
-		typedef std::map<UInt32,const char*> IdMap;
-		IdMap _idMap;
+
+		//ids index fixed size chunks, a slot is only ever written once, before its pointer gets published
+		enum { CHUNK_SIZE = 256, MAX_CHUNKS = 256 };
+		struct Chunk
+		{
+			Chunk() { for (size_t i=0; i<CHUNK_SIZE; i++) slots[i] = nullptr; }
+			tbb::atomic<const char*> slots[CHUNK_SIZE];
+		};
+		tbb::atomic<Chunk*> _chunks[MAX_CHUNKS];
 
 		UInt32 _nextId;
 	} _prepStmtRegistry;
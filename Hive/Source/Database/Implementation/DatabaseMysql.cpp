@@ -92,18 +92,8 @@ std::string DatabaseMysql::sqlOffset() const
 }
 
 MySQLConnection::MySQLConnection( ConcreteDatabase& db, const std::string& infoString ) 
-	: SqlConnection(db), _myConn(nullptr)
+	: SqlConnection(db), _protocol(0), _myHandle(nullptr), _myConn(nullptr)
 {
-	_myHandle = mysql_init(nullptr);
-	poco_assert(_myHandle != nullptr);
-	{
-		//Set charset for the connection string
-		mysql_options(_myHandle,MYSQL_SET_CHARSET_NAME,"utf8");
-		//Disable automatic reconnection, we will do this manually (to re-create broken statements and such)
-		my_bool reconnect = 0;
-		mysql_options(_myHandle, MYSQL_OPT_RECONNECT, &reconnect);
-	}
-
 	std::string port_or_socket;
 	{
 		typedef Poco::StringTokenizer Tokens;
@@ -127,8 +117,7 @@ MySQLConnection::MySQLConnection( ConcreteDatabase& db, const std::string& infoS
 	//Windows named pipe option
 	if(_host==".")                                           
 	{
-		unsigned int opt = MYSQL_PROTOCOL_PIPE;
-		mysql_options(_myHandle,MYSQL_OPT_PROTOCOL,(char const*)&opt);
+		_protocol = MYSQL_PROTOCOL_PIPE;
 		_port = 0;
 		_unix_socket.clear();
 	}
@@ -141,8 +130,7 @@ MySQLConnection::MySQLConnection( ConcreteDatabase& db, const std::string& infoS
 	//Unix/Linux socket option
 	if(_host==".")
 	{
-		unsigned int opt = MYSQL_PROTOCOL_SOCKET;
-		mysql_options(mysqlInit,MYSQL_OPT_PROTOCOL,(char const*)&opt);
+		_protocol = MYSQL_PROTOCOL_SOCKET;
 		_host = "localhost";
 		_port = 0;
 		_unix_socket = port_or_socket;
@@ -153,6 +141,37 @@ MySQLConnection::MySQLConnection( ConcreteDatabase& db, const std::string& infoS
 		_unix_socket.clear();
 	}
 #endif
+
+	initHandle();
+}
+
+void MySQLConnection::initHandle()
+{
+	_myHandle = mysql_init(nullptr);
+	poco_assert(_myHandle != nullptr);
+	{
+		//Set charset for the connection string
+		mysql_options(_myHandle,MYSQL_SET_CHARSET_NAME,"utf8");
+		//Disable automatic reconnection, we will do this manually (to re-create broken statements and such)
+		my_bool reconnect = 0;
+		mysql_options(_myHandle, MYSQL_OPT_RECONNECT, &reconnect);
+	}
+
+	//named pipe or unix socket
+	if (_protocol != 0)
+		mysql_options(_myHandle,MYSQL_OPT_PROTOCOL,(char const*)&_protocol);
+}
+
+void MySQLConnection::disconnect()
+{
+	this->clear();
+
+	//closing frees the handle too, so the next connect() starts from a fresh one
+	if (_myHandle)
+		mysql_close(_myHandle);
+
+	_myConn = nullptr;
+	initHandle();
 }
 
 MySQLConnection::~MySQLConnection()
@@ -247,7 +266,8 @@ void MySQLConnection::connect()
 		if (_unix_socket.length() > 0)
 			unix_socket = _unix_socket.c_str();
 
-		_myConn = mysql_real_connect(_myHandle, _host.c_str(), _user.c_str(), _password.c_str(), _database.c_str(), _port, unix_socket, CLIENT_REMEMBER_OPTIONS);
+		//multi results are required to CALL procedures that return rows
+		_myConn = mysql_real_connect(_myHandle, _host.c_str(), _user.c_str(), _password.c_str(), _database.c_str(), _port, unix_socket, CLIENT_REMEMBER_OPTIONS | CLIENT_MULTI_RESULTS);
 		if (!_myConn)
 		{
 			const char* actionToDo = "connect";
@@ -312,6 +332,30 @@ void MySQLConnection::_MySQLStmtExecute(const SqlPreparedStatement& who, MYSQL_S
 	}
 }
 
+void MySQLConnection::_MySQLStmtStoreResult(const SqlPreparedStatement& who, MYSQL_STMT* stmt)
+{
+	int returnVal = mysql_stmt_store_result(stmt);
+	if (returnVal)
+	{
+		auto errInfo = StmtErrorInfo(who.lastError());
+		throw SqlException(who.lastError(),who.lastErrorDescr(),"MySQLStmtStoreResult",errInfo.first,!errInfo.second,who.getSqlString(true));
+	}
+}
+
+bool MySQLConnection::_MySQLStmtFetch(const SqlPreparedStatement& who, MYSQL_STMT* stmt)
+{
+	int returnVal = mysql_stmt_fetch(stmt);
+	if (returnVal == MYSQL_NO_DATA)
+		return false;
+	//truncated columns get refetched by the caller
+	if (returnVal != 0 && returnVal != MYSQL_DATA_TRUNCATED)
+	{
+		auto errInfo = StmtErrorInfo(who.lastError());
+		throw SqlException(who.lastError(),who.lastErrorDescr(),"MySQLStmtFetch",errInfo.first,!errInfo.second,who.getSqlString(true));
+	}
+	return true;
+}
+
 void MySQLConnection::_MySQLQuery(const char* sql)
 {
 	int returnVal = mysql_query(_myConn,sql);
@@ -345,6 +389,28 @@ MYSQL_RES* MySQLConnection::_MySQLStoreResult(const char* sql, UInt64& outRowCou
 	return outResult;
 }
 
+void MySQLConnection::_MySQLDrainResults(const char* sql)
+{
+	//procedure calls end with an extra status result, anything past the first result is discarded
+	for (;;)
+	{
+		int returnVal = mysql_next_result(_myConn);
+		if (returnVal < 0) //no more results
+			break;
+
+		if (returnVal > 0)
+		{
+			returnVal = mysql_errno(_myConn);
+			bool connLost = IsConnectionLost(returnVal);
+			throw SqlException(returnVal,mysql_error(_myConn),"MySQLNextResult",connLost,connLost,sql);
+		}
+
+		MYSQL_RES* extraResult = mysql_store_result(_myConn);
+		if (extraResult)
+			mysql_free_result(extraResult);
+	}
+}
+
 bool MySQLConnection::_Query(const char* sql, MYSQL_RES*& outResult, MYSQL_FIELD*& outFields, UInt64& outRowCount, size_t& outFieldCount)
 {
 	if (!_myConn)
@@ -355,6 +421,17 @@ bool MySQLConnection::_Query(const char* sql, MYSQL_RES*& outResult, MYSQL_FIELD
 	outRowCount = 0;
 	outFieldCount = 0;
 	outResult = _MySQLStoreResult(sql,outRowCount,outFieldCount);
+	if (mysql_more_results(_myConn))
+	{
+		try { _MySQLDrainResults(sql); }
+		catch (...)
+		{
+			if (outResult)
+				mysql_free_result(outResult);
+
+			throw;
+		}
+	}
 
 	if (outResult)
 		outFields = mysql_fetch_fields(outResult);
@@ -399,6 +476,32 @@ unique_ptr<QueryNamedResult> MySQLConnection::namedQuery(const char* sql)
 	return unique_ptr<QueryNamedResult>(new QueryNamedResult(std::move(queryResult),names));
 }
 
+unique_ptr<QueryResult> MySQLConnection::queryStreamed(const char* sql)
+{
+	if (!_myConn)
+		return nullptr;
+
+	_MySQLQuery(sql);
+
+	MYSQL_RES* result = mysql_use_result(_myConn);
+	if (!result)
+	{
+		int resultRetVal = mysql_errno(_myConn);
+		if (resultRetVal)
+			throw SqlException(resultRetVal,mysql_error(_myConn),"MySQLUseResult",IsConnectionLost(resultRetVal),true,sql);
+
+		//no rows to stream, so it's the same as a plain query
+		UInt64 rowCount = mysql_affected_rows(_myConn);
+		size_t fieldCount = mysql_field_count(_myConn);
+		if (mysql_more_results(_myConn))
+			_MySQLDrainResults(sql);
+
+		return unique_ptr<QueryResult>(new QueryResultMysql(nullptr, nullptr, rowCount, fieldCount));
+	}
+
+	return unique_ptr<QueryResult>(new QueryResultMysqlStream(_myConn, result, mysql_fetch_fields(result), mysql_num_fields(result), _dbEngine->getLogger()));
+}
+
 bool MySQLConnection::execute(const char* sql)
 {
 	if (!_myConn)
@@ -406,6 +509,16 @@ bool MySQLConnection::execute(const char* sql)
 
 	_MySQLQuery(sql);
 
+	if (mysql_field_count(_myConn) > 0 || mysql_more_results(_myConn))
+	{
+		//leaving unread results would put the connection out of sync
+		MYSQL_RES* unwanted = mysql_store_result(_myConn);
+		if (unwanted)
+			mysql_free_result(unwanted);
+
+		_MySQLDrainResults(sql);
+	}
+
 	return true;
 }
 
@@ -446,7 +559,7 @@ SqlPreparedStatement* MySQLConnection::createPreparedStatement( const char* sqlT
 
 //////////////////////////////////////////////////////////////////////////
 MySqlPreparedStatement::MySqlPreparedStatement( const char* sqlText, MySQLConnection& conn ) : SqlPreparedStatement(sqlText, conn), 
-	_mySqlConn(conn), _myStmt(nullptr), _myResMeta(nullptr) {}
+	_mySqlConn(conn), _myStmt(nullptr), _argsBound(false), _layoutChanges(0), _myResMeta(nullptr) {}
 
 MySqlPreparedStatement::~MySqlPreparedStatement()
 {
@@ -493,10 +606,16 @@ void MySqlPreparedStatement::prepare()
 	if (!_myResMeta && (!strnicmp("select",_stmtSql,6)))
 		poco_bugcheck_msg(Poco::format("SQL: no meta information for '%s', ERROR %s",this->getSqlString(),this->lastErrorDescr()).c_str());
 
-	//set up bind input buffers
+	//set up bind input buffers, sized once here since the binds keep pointing into them
 	_myArgs.resize(_numParams);
+	_argBufs.resize(_numParams);
 	for (size_t i=0;i<_myArgs.size();i++)
+	{
 		memset(&_myArgs[i], 0, sizeof(MYSQL_BIND));
+		_argBufs[i].type = SqlStmtField::FIELD_COUNT;
+		_argBufs[i].data.resize(sizeof(Int64));
+		_argBufs[i].length = 0;
+	}
 
 	//check if we have a statement which returns result sets
 	if(_myResMeta)
@@ -507,13 +626,48 @@ void MySqlPreparedStatement::prepare()
 		_numColumns = mysql_num_fields(_myResMeta);
 
 		//set up bind output buffers
+		MYSQL_FIELD* fields = mysql_fetch_fields(_myResMeta);
 		_myRes.resize(_numColumns);
+		_resCols.resize(_numColumns);
 		for (size_t i=0;i<_myRes.size();i++)
 		{
 			MYSQL_BIND& curr = _myRes[i];
 			memset(&curr,0,sizeof(MYSQL_BIND));
-			//TODO: implement fetching results from statements
+
+			ResultColumn& col = _resCols[i];
+			switch (fields[i].type)
+			{
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				col.kind = (fields[i].flags & UNSIGNED_FLAG) ? ResultColumn::COL_UINT : ResultColumn::COL_INT;
+				curr.buffer_type = MYSQL_TYPE_LONGLONG;
+				curr.is_unsigned = (col.kind == ResultColumn::COL_UINT);
+				curr.buffer = &col.num.i64;
+				curr.buffer_length = sizeof(col.num.i64);
+				break;
+			case MYSQL_TYPE_FLOAT:
+			case MYSQL_TYPE_DOUBLE:
+				col.kind = ResultColumn::COL_DOUBLE;
+				curr.buffer_type = MYSQL_TYPE_DOUBLE;
+				curr.buffer = &col.num.dbl;
+				curr.buffer_length = sizeof(col.num.dbl);
+				break;
+			//decimals stay text so they don't lose precision
+			default:
+				col.kind = ResultColumn::COL_TEXT;
+				col.text.resize(64);
+				curr.buffer_type = MYSQL_TYPE_STRING;
+				break;
+			}
+			col.length = 0;
+			col.isNull = 0;
+			col.error = 0;
 		}
+		bindResults();
 	}
 
 	_prepared = true;
@@ -535,17 +689,47 @@ void MySqlPreparedStatement::bind( const SqlStmtParameters& holder )
 		return;
 	}
 
-	size_t nIndex = 0;
-	const SqlStmtParameters::ParameterContainer& holderArgs = holder.params();
-	for (auto it = holderArgs.begin(); it!=holderArgs.end(); ++it)
+	bool layoutChanged = false;
+	bool rebind = !_argsBound;
+	for (size_t nIndex=0; nIndex<holder.boundParams(); nIndex++)
+	{
+		SqlStmtField data = holder.param(nIndex);
+		ArgBuffer& arg = _argBufs[nIndex];
+		if (arg.type != data.type())
+		{
+			layoutChanged = _argsBound;
+			rebind = true;
+			arg.type = static_cast<UInt8>(data.type());
+		}
+		//growing moves the buffer, so the bind has to be pointed at it again
+		if (data.size() > arg.data.size())
+		{
+			arg.data.resize(std::max<size_t>(data.size(),arg.data.size()*2));
+			rebind = true;
+		}
+		if (data.size() > 0)
+			memcpy(&arg.data[0],data.buff(),data.size());
+		arg.length = data.size();
+	}
+
+	if (!rebind)
+		return;
+
+	for (size_t nIndex=0; nIndex<holder.boundParams(); nIndex++)
+		addParam(nIndex, holder.param(nIndex));
+
+	if (layoutChanged)
 	{
-		//bind parameter
-		addParam(nIndex++, (*it));
+		_layoutChanges++;
+		_conn.getDB().getLogger().debug(Poco::format("SQL: bind layout of '%s' changed (%u times)",this->getSqlString(),_layoutChanges));
 	}
 
 	//bind input arguments
+	_argsBound = false;
 	if(mysql_stmt_bind_param(_myStmt, &_myArgs[0]))
 		poco_bugcheck_msg((string("mysql_stmt_bind_param() failed with ERROR ")+mysql_stmt_error(_myStmt)).c_str());
+
+	_argsBound = true;
 }
 
 namespace
@@ -584,6 +768,7 @@ void MySqlPreparedStatement::addParam( size_t nIndex, const SqlStmtField& data )
 	poco_assert(nIndex < _numParams);
 
 	MYSQL_BIND& pData = _myArgs[nIndex];
+	ArgBuffer& arg = _argBufs[nIndex];
 
 	//setup MYSQL_BIND structure
 	{
@@ -591,17 +776,40 @@ void MySqlPreparedStatement::addParam( size_t nIndex, const SqlStmtField& data )
 		pData.buffer_type = typeInfo.first;
 		pData.is_unsigned = typeInfo.second;
 	}
-	pData.buffer = const_cast<void*>(data.buff());
-	pData.length = nullptr;
-	pData.buffer_length = data.size();
+	pData.buffer = &arg.data[0];
+	pData.length = &arg.length;
+	pData.buffer_length = arg.data.size();
 	pData.is_null = nullptr;
 	pData.error = nullptr;
 }
 
+void MySqlPreparedStatement::bindResults()
+{
+	for (size_t i=0;i<_myRes.size();i++)
+	{
+		MYSQL_BIND& curr = _myRes[i];
+		ResultColumn& col = _resCols[i];
+		if (col.kind == ResultColumn::COL_TEXT)
+		{
+			curr.buffer = &col.text[0];
+			curr.buffer_length = col.text.size();
+		}
+		curr.length = &col.length;
+		curr.is_null = &col.isNull;
+		curr.error = &col.error;
+	}
+
+	if (_myRes.size() > 0 && mysql_stmt_bind_result(_myStmt, &_myRes[0]))
+		poco_bugcheck_msg((string("mysql_stmt_bind_result() failed with ERROR ")+mysql_stmt_error(_myStmt)).c_str());
+}
+
 void MySqlPreparedStatement::unprepare()
 {
 	_myArgs.clear();
+	_argBufs.clear();
+	_argsBound = false;
 	_myRes.clear();
+	_resCols.clear();
 
 	if (_myResMeta)
 	{
@@ -693,11 +901,11 @@ namespace
 				return lexical_cast<string>(dest);
 			}
 		case MYSQL_TYPE_STRING:
-			return "\"" + string((const char*)par.buffer,par.buffer_length) + "\"";
+			return "\"" + string((const char*)par.buffer,par.length ? *par.length : par.buffer_length) + "\"";
 		case MYSQL_TYPE_BLOB:
 			{
 				std::ostringstream ss;
-				Poco::HexBinaryEncoder(ss).write((const char*)par.buffer,par.buffer_length);
+				Poco::HexBinaryEncoder(ss).write((const char*)par.buffer,par.length ? *par.length : par.buffer_length);
 				ss.flush();
 				return "HEX(" + ss.str() + ")";
 			}
@@ -739,4 +947,81 @@ bool MySqlPreparedStatement::execute()
 	return true;
 }
 
+void MySQLConnection::_MySQLStmtFetchColumn(const SqlPreparedStatement& who, MYSQL_STMT* stmt, MYSQL_BIND* bind, unsigned int column)
+{
+	int returnVal = mysql_stmt_fetch_column(stmt, bind, column, 0);
+	if (returnVal)
+	{
+		auto errInfo = StmtErrorInfo(who.lastError());
+		throw SqlException(who.lastError(),who.lastErrorDescr(),"MySQLStmtFetchColumn",errInfo.first,!errInfo.second,who.getSqlString(true));
+	}
+}
+
+unique_ptr<QueryResult> MySqlPreparedStatement::query()
+{
+	poco_assert(isPrepared());
+	if (!isQuery())
+		poco_bugcheck_msg(Poco::format("SQL: '%s' isn't a query",this->getSqlString()).c_str());
+
+	_mySqlConn._MySQLStmtExecute(*this, _myStmt);
+
+	unique_ptr<QueryResultMysqlStmt> res;
+	try
+	{
+		//the whole set is buffered, so the server side is done with it before we return
+		_mySqlConn._MySQLStmtStoreResult(*this, _myStmt);
+		res.reset(new QueryResultMysqlStmt(mysql_fetch_fields(_myResMeta), mysql_stmt_num_rows(_myStmt), _numColumns));
+
+		while (_mySqlConn._MySQLStmtFetch(*this, _myStmt))
+		{
+			bool rebind = false;
+			for (size_t i=0;i<_resCols.size();i++)
+			{
+				ResultColumn& col = _resCols[i];
+				if (col.isNull)
+				{
+					res->addNull();
+					continue;
+				}
+
+				switch (col.kind)
+				{
+				case ResultColumn::COL_INT:		res->addInt64(col.num.i64);						break;
+				case ResultColumn::COL_UINT:	res->addUInt64(static_cast<UInt64>(col.num.i64));	break;
+				case ResultColumn::COL_DOUBLE:	res->addDouble(col.num.dbl);						break;
+				default:
+					{
+						//didn't fit, grow the buffer and get the rest of this column
+						if (col.length > col.text.size())
+						{
+							col.text.resize(col.length);
+							MYSQL_BIND& curr = _myRes[i];
+							curr.buffer = &col.text[0];
+							curr.buffer_length = col.text.size();
+							rebind = true;
+							_mySqlConn._MySQLStmtFetchColumn(*this, _myStmt, &curr, static_cast<unsigned int>(i));
+						}
+						res->addText(&col.text[0], col.length);
+					}
+					break;
+				}
+			}
+
+			//the larger buffers are kept for the following rows and executions
+			if (rebind)
+				bindResults();
+		}
+	}
+	catch (const SqlConnection::SqlException&)
+	{
+		mysql_stmt_free_result(_myStmt);
+		//the library still has the binds from before a buffer grew, those point at freed memory
+		bindResults();
+		throw;
+	}
+	mysql_stmt_free_result(_myStmt);
+
+	return std::move(res);
+}
+
 #endif
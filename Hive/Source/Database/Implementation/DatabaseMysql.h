@@ -47,10 +47,15 @@ public:
 
 	//execute DML statement
 	bool execute() override;
+	//execute SELECT, binding results by type
+	unique_ptr<QueryResult> query() override;
 
 	int lastError() const override;
 	std::string lastErrorDescr() const override;
 
+	//how many times the input types differed from the previous execution
+	UInt32 layoutChanges() const { return _layoutChanges; }
+
 	std::string getSqlString(bool withValues=false) const override
 	{
 		std::string retStr = SqlPreparedStatement::getSqlString();
@@ -65,12 +70,41 @@ protected:
 private:
 	void unprepare();
 	std::string bindParamsToStr() const;
+	//point the result binds at their column buffers
+	void bindResults();
 
 	class MySQLConnection& _mySqlConn;
 	MYSQL_STMT* _myStmt;
 	std::vector<MYSQL_BIND>	_myArgs;
+	//values are copied into buffers the statement owns and the binds point at,
+	//so while types match and values fit, nothing has to be bound again
+	struct ArgBuffer
+	{
+		UInt8 type;
+		std::vector<char> data;
+		unsigned long length;
+	};
+	std::vector<ArgBuffer> _argBufs;
+	bool _argsBound;
+	UInt32 _layoutChanges;
 	std::vector<MYSQL_BIND>	_myRes;
 	MYSQL_RES* _myResMeta;
+
+	//output buffer of one result column, numbers are fetched as 64bit ints or doubles, everything else as text
+	struct ResultColumn
+	{
+		enum Kind { COL_INT, COL_UINT, COL_DOUBLE, COL_TEXT } kind;
+		union
+		{
+			Int64 i64;
+			double dbl;
+		} num;
+		std::vector<char> text;
+		unsigned long length;
+		my_bool isNull;
+		my_bool error;
+	};
+	std::vector<ResultColumn> _resCols;
 };
 
 class MySQLConnection : public SqlConnection
@@ -83,9 +117,11 @@ public:
 
 	//Connect or reconnect using stored credentials
 	void connect() override;
+	void disconnect() override;
 
 	unique_ptr<QueryResult> query(const char* sql) override;
 	unique_ptr<QueryNamedResult> namedQuery(const char* sql) override;
+	unique_ptr<QueryResult> queryStreamed(const char* sql) override;
 	bool execute(const char* sql);
 
 	size_t escapeString(char* to, const char* from, size_t length) const override;
@@ -97,18 +133,27 @@ public:
 	MYSQL_STMT* _MySQLStmtInit();
 	void _MySQLStmtPrepare(const SqlPreparedStatement& who, MYSQL_STMT* stmt, const char* sqlText, size_t textLen);
 	void _MySQLStmtExecute(const SqlPreparedStatement& who, MYSQL_STMT* stmt);
+	void _MySQLStmtStoreResult(const SqlPreparedStatement& who, MYSQL_STMT* stmt);
+	//false when there are no more rows
+	bool _MySQLStmtFetch(const SqlPreparedStatement& who, MYSQL_STMT* stmt);
+	void _MySQLStmtFetchColumn(const SqlPreparedStatement& who, MYSQL_STMT* stmt, MYSQL_BIND* bind, unsigned int column);
 protected:
 	SqlPreparedStatement* createPreparedStatement(const char* sqlText) override;
 
 private:
+	//new handle with our options set
+	void initHandle();
+
 	bool _TransactionCmd(const char* sql);
 	bool _Query(const char* sql, MYSQL_RES*& outResult, MYSQL_FIELD*& outFields, UInt64& outRowCount, size_t& outFieldCount);
 	void _MySQLQuery(const char* sql);
+	void _MySQLDrainResults(const char* sql);
 	MYSQL_RES* _MySQLStoreResult(const char* sql, UInt64& outRowCount, size_t& outFieldCount);
 
 	std::string _host, _user, _password, _database;
 	int _port;
 	std::string _unix_socket;
+	unsigned int _protocol;
 
 	MYSQL* _myHandle;
 	MYSQL* _myConn;
@@ -20,6 +20,9 @@
 
 #include "QueryResultMysql.h"
 
+#include <Poco/Logger.h>
+#include <Poco/Format.h>
+
 namespace
 {
 	Field::DataTypes MySQLTypeToFieldType(enum_field_types mysqlType)
@@ -83,12 +86,179 @@ bool QueryResultMysql::fetchRow()
         return false;
     }
 
+    unsigned long* lengths = mysql_fetch_lengths(_myRes);
     for (size_t i=0; i<numFields(); i++)
-        _row[i].setValue(myRow[i]);
+    {
+        if (lengths)
+            _row[i].setValue(myRow[i],lengths[i]);
+        else
+            _row[i].setValue(myRow[i]);
+    }
 
     return true;
 }
 
+QueryResultMysqlStream::QueryResultMysqlStream(MYSQL* conn, MYSQL_RES* result, MYSQL_FIELD* fields, size_t fieldCount, Poco::Logger& logger) :
+	QueryResultImpl(0, fieldCount), _myConn(conn), _myRes(result), _logger(logger), _rowsRead(0), _incomplete(false)
+{
+	if (fields != nullptr)
+	{
+		for (size_t i=0; i<numFields(); i++)
+			_row[i].setType(MySQLTypeToFieldType(fields[i].type));
+	}
+}
+
+QueryResultMysqlStream::~QueryResultMysqlStream()
+{
+	finish();
+}
+
+bool QueryResultMysqlStream::fetchRow()
+{
+	if (!_myRes)
+		return false;
+
+	MYSQL_ROW myRow = mysql_fetch_row(_myRes);
+	if (!myRow)
+	{
+		//the end of the rows and a dropped connection look the same, apart from this
+		if (mysql_errno(_myConn))
+		{
+			_incomplete = true;
+			_logger.error(Poco::format("Streamed result broke off after %Lu rows: [%u] %s",
+				_rowsRead,mysql_errno(_myConn),std::string(mysql_error(_myConn))));
+		}
+		finish();
+		return false;
+	}
+
+	unsigned long* lengths = mysql_fetch_lengths(_myRes);
+	for (size_t i=0; i<numFields(); i++)
+	{
+		if (lengths)
+			_row[i].setValue(myRow[i],lengths[i]);
+		else
+			_row[i].setValue(myRow[i]);
+	}
+
+	_rowsRead++;
+	return true;
+}
+
+void QueryResultMysqlStream::finish()
+{
+	_row.clear();
+
+	if (!_myRes)
+		return;
+
+	//this reads and throws away any rows we didn't get to
+	mysql_free_result(_myRes);
+	_myRes = nullptr;
+
+	//procedure calls end with an extra status result
+	while (mysql_more_results(_myConn))
+	{
+		int returnVal = mysql_next_result(_myConn);
+		if (returnVal < 0)
+			break;
+		if (returnVal > 0)
+		{
+			_logger.error(Poco::format("Failed to skip trailing results of a streamed query: [%u] %s",mysql_errno(_myConn),std::string(mysql_error(_myConn))));
+			break;
+		}
+
+		MYSQL_RES* extraResult = mysql_store_result(_myConn);
+		if (extraResult)
+			mysql_free_result(extraResult);
+	}
+}
+
+QueryResultMysqlStmt::QueryResultMysqlStmt(MYSQL_FIELD* fields, UInt64 rowCount, size_t fieldCount) :
+	QueryResultImpl(rowCount, fieldCount), _nextValue(0)
+{
+	if (fields != nullptr)
+	{
+		for (size_t i=0; i<numFields(); i++)
+			_row[i].setType(MySQLTypeToFieldType(fields[i].type));
+	}
+	_values.reserve(static_cast<size_t>(rowCount)*fieldCount);
+}
+
+void QueryResultMysqlStmt::addNull()
+{
+	Value val;
+	val.kind = VALUE_NULL;
+	val.num.i64 = 0;
+	val.offset = val.length = 0;
+	_values.push_back(val);
+}
+
+void QueryResultMysqlStmt::addInt64( Int64 value )
+{
+	Value val;
+	val.kind = VALUE_INT;
+	val.num.i64 = value;
+	val.offset = val.length = 0;
+	_values.push_back(val);
+}
+
+void QueryResultMysqlStmt::addUInt64( UInt64 value )
+{
+	Value val;
+	val.kind = VALUE_UINT;
+	val.num.u64 = value;
+	val.offset = val.length = 0;
+	_values.push_back(val);
+}
+
+void QueryResultMysqlStmt::addDouble( double value )
+{
+	Value val;
+	val.kind = VALUE_DOUBLE;
+	val.num.dbl = value;
+	val.offset = val.length = 0;
+	_values.push_back(val);
+}
+
+void QueryResultMysqlStmt::addText( const char* data, size_t length )
+{
+	Value val;
+	val.kind = VALUE_TEXT;
+	val.num.i64 = 0;
+	val.offset = _text.length();
+	val.length = length;
+	_values.push_back(val);
+
+	_text.append(data,length);
+	//so every value can also be read as a C string
+	_text.push_back(0);
+}
+
+bool QueryResultMysqlStmt::fetchRow()
+{
+	if (numFields() < 1 || _nextValue + numFields() > _values.size())
+	{
+		_row.clear();
+		return false;
+	}
+
+	for (size_t i=0; i<numFields(); i++)
+	{
+		const Value& val = _values[_nextValue++];
+		switch (val.kind)
+		{
+		case VALUE_INT:		_row[i].setInt64(val.num.i64);					break;
+		case VALUE_UINT:	_row[i].setUInt64(val.num.u64);					break;
+		case VALUE_DOUBLE:	_row[i].setDouble(val.num.dbl);					break;
+		case VALUE_TEXT:	_row[i].setValue(&_text[val.offset],val.length);	break;
+		default:			_row[i].setNull();								break;
+		}
+	}
+
+	return true;
+}
+
 void QueryResultMysql::finish()
 {
 	_row.clear();
@@ -23,6 +23,8 @@
 #include "Shared/Common/Types.h"
 #include "QueryResultImpl.h"
 
+namespace Poco { class Logger; };
+
 #ifdef WIN32
 #include <winsock2.h>
 #include <mysql/mysql.h>
@@ -43,4 +45,68 @@ private:
 	MYSQL_RES* _myRes;
 };
 
+//rows read from the server one fetchRow at a time (mysql_use_result)
+//the connection can't run anything else until this is finished or destroyed
+class QueryResultMysqlStream : public QueryResultImpl
+{
+public:
+	QueryResultMysqlStream(MYSQL* conn, MYSQL_RES* result, MYSQL_FIELD* fields, size_t fieldCount, Poco::Logger& logger);
+	~QueryResultMysqlStream();
+
+	bool fetchRow() override;
+	UInt64 numRows() const override { return _rowsRead; }
+	bool incomplete() const override { return _incomplete; }
+private:
+	//skips whatever wasn't read, so the connection is usable again
+	void finish();
+
+	MYSQL* _myConn;
+	MYSQL_RES* _myRes;
+	Poco::Logger& _logger;
+	UInt64 _rowsRead;
+	bool _incomplete;
+};
+
+//rows of a prepared statement query, copied out since the statement's bind buffers get reused
+class QueryResultMysqlStmt : public QueryResultImpl
+{
+public:
+	QueryResultMysqlStmt(MYSQL_FIELD* fields, UInt64 rowCount, size_t fieldCount);
+	~QueryResultMysqlStmt() {}
+
+	//filled column by column, row by row
+	void addNull();
+	void addInt64(Int64 value);
+	void addUInt64(UInt64 value);
+	void addDouble(double value);
+	void addText(const char* data, size_t length);
+
+	bool fetchRow() override;
+private:
+	enum ValueKind
+	{
+		VALUE_NULL,
+		VALUE_INT,
+		VALUE_UINT,
+		VALUE_DOUBLE,
+		VALUE_TEXT
+	};
+	struct Value
+	{
+		ValueKind kind;
+		union
+		{
+			Int64 i64;
+			UInt64 u64;
+			double dbl;
+		} num;
+		size_t offset;
+		size_t length;
+	};
+	vector<Value> _values;
+	//all text values back to back, fields point into this
+	string _text;
+	size_t _nextValue;
+};
+
 #endif
\ No newline at end of file
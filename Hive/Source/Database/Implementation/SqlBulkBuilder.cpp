@@ -0,0 +1,324 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlBulkBuilder.h"
+#include "ConcreteDatabase.h"
+
+#include <Poco/String.h>
+#include <boost/lexical_cast.hpp>
+#include <set>
+#include <algorithm>
+using boost::lexical_cast;
+
+namespace
+{
+	//plain or backticked column/table name, returned without the backticks
+	bool ParseIdentifier( string text, string& out )
+	{
+		text = Poco::trim(text);
+		if (text.length() > 1 && text[0] == '`' && text[text.length()-1] == '`')
+			text = text.substr(1,text.length()-2);
+		if (text.empty())
+			return false;
+
+		for (size_t i=0;i<text.length();i++)
+		{
+			char c = text[i];
+			if (!isalnum(static_cast<unsigned char>(c)) && c != '_')
+				return false;
+		}
+		out = text;
+		return true;
+	}
+
+	//`col` = ?
+	bool ParseAssignment( const string& text, string& col )
+	{
+		size_t eqPos = text.find('=');
+		if (eqPos == string::npos)
+			return false;
+		if (Poco::trim(text.substr(eqPos+1)) != "?")
+			return false;
+
+		return ParseIdentifier(text.substr(0,eqPos),col);
+	}
+
+	//splits on sep, which is expected in lower case
+	vector<string> SplitLower( const string& text, const string& sep )
+	{
+		vector<string> parts;
+		string lower = Poco::toLower(text);
+		size_t start = 0;
+		for (;;)
+		{
+			size_t pos = lower.find(sep,start);
+			if (pos == string::npos)
+			{
+				parts.push_back(text.substr(start));
+				break;
+			}
+			parts.push_back(text.substr(start,pos-start));
+			start = pos + sep.length();
+		}
+		return parts;
+	}
+};
+
+bool SqlBulkBuilder::parse( const char* sqlText, size_t numArgs )
+{
+	_kind = BULK_NONE;
+	if (!sqlText || numArgs < 1)
+		return false;
+
+	string sql = Poco::trim(string(sqlText));
+	string lower = Poco::toLower(sql);
+	//quoted text could hold anything, don't try to make sense of it
+	if (sql.find('\'') != string::npos || sql.find('"') != string::npos)
+		return false;
+
+	if (lower.compare(0,6,"insert") == 0 || lower.compare(0,7,"replace") == 0)
+	{
+		size_t valPos = lower.find(" values");
+		if (valPos == string::npos)
+			return false;
+
+		size_t openPos = lower.find_first_not_of(" \t\r\n",valPos+7);
+		if (openPos == string::npos || sql[openPos] != '(')
+			return false;
+
+		size_t closePos = string::npos;
+		int depth = 0;
+		for (size_t i=openPos;i<sql.length();i++)
+		{
+			if (sql[i] == '(')
+				depth++;
+			else if (sql[i] == ')' && --depth == 0)
+			{
+				closePos = i;
+				break;
+			}
+		}
+		if (closePos == string::npos)
+			return false;
+
+		_head = sql.substr(0,openPos);
+		_tail = sql.substr(closePos+1);
+		//every placeholder has to be in the tuple
+		if (std::count(_head.begin(),_head.end(),'?') > 0 || std::count(_tail.begin(),_tail.end(),'?') > 0)
+			return false;
+
+		string tuple = sql.substr(openPos,closePos-openPos+1);
+		_tupleParts.clear();
+		size_t start = 0;
+		for (;;)
+		{
+			size_t pos = tuple.find('?',start);
+			if (pos == string::npos)
+			{
+				_tupleParts.push_back(tuple.substr(start));
+				break;
+			}
+			_tupleParts.push_back(tuple.substr(start,pos-start));
+			start = pos+1;
+		}
+		if (_tupleParts.size() != numArgs+1)
+			return false;
+
+		_kind = BULK_INSERT;
+		return true;
+	}
+	else if (lower.compare(0,7,"update ") == 0)
+	{
+		size_t setPos = lower.find(" set ");
+		size_t wherePos = lower.find(" where ");
+		if (setPos == string::npos || wherePos == string::npos || wherePos < setPos)
+			return false;
+		//only a single table, no joins or aliases
+		if (!ParseIdentifier(sql.substr(7,setPos-7),_table))
+			return false;
+
+		string setText = sql.substr(setPos+5,wherePos-setPos-5);
+		string whereText = sql.substr(wherePos+7);
+		if (setText.find('(') != string::npos || whereText.find('(') != string::npos)
+			return false;
+
+		_setCols.clear();
+		vector<string> sets = SplitLower(setText,",");
+		for (size_t i=0;i<sets.size();i++)
+		{
+			string col;
+			if (!ParseAssignment(sets[i],col))
+				return false;
+			_setCols.push_back(col);
+		}
+
+		_keyCols.clear();
+		vector<string> conds = SplitLower(whereText," and ");
+		for (size_t i=0;i<conds.size();i++)
+		{
+			string col;
+			if (!ParseAssignment(conds[i],col))
+				return false;
+			_keyCols.push_back(col);
+		}
+
+		if (_setCols.size() + _keyCols.size() != numArgs)
+			return false;
+
+		_kind = BULK_UPDATE;
+		return true;
+	}
+
+	return false;
+}
+
+string SqlBulkBuilder::literal( const SqlStmtField& data, const ConcreteDatabase& db ) const
+{
+	switch (data.type())
+	{
+	case SqlStmtField::FIELD_BOOL:		return data.toBool() ? "1" : "0";
+	case SqlStmtField::FIELD_UI8:		return lexical_cast<string>(UInt32(data.toUint8()));
+	case SqlStmtField::FIELD_UI16:		return lexical_cast<string>(data.toUint16());
+	case SqlStmtField::FIELD_UI32:		return lexical_cast<string>(data.toUint32());
+	case SqlStmtField::FIELD_UI64:		return lexical_cast<string>(data.toUint64());
+	case SqlStmtField::FIELD_I8:		return lexical_cast<string>(Int32(data.toInt8()));
+	case SqlStmtField::FIELD_I16:		return lexical_cast<string>(data.toInt16());
+	case SqlStmtField::FIELD_I32:		return lexical_cast<string>(data.toInt32());
+	case SqlStmtField::FIELD_I64:		return lexical_cast<string>(data.toInt64());
+	case SqlStmtField::FIELD_FLOAT:		return lexical_cast<string>(data.toFloat());
+	case SqlStmtField::FIELD_DOUBLE:	return lexical_cast<string>(data.toDouble());
+	case SqlStmtField::FIELD_STRING:	return "'" + db.escape(data.toString()) + "'";
+	case SqlStmtField::FIELD_BINARY:
+		{
+			static const char HEX_DIGITS[] = "0123456789ABCDEF";
+			const UInt8* bytes = static_cast<const UInt8*>(data.buff());
+			string lit = "x'";
+			lit.reserve(data.size()*2+3);
+			for (size_t i=0;i<data.size();i++)
+			{
+				lit.push_back(HEX_DIGITS[bytes[i] >> 4]);
+				lit.push_back(HEX_DIGITS[bytes[i] & 0x0F]);
+			}
+			lit.push_back('\'');
+			return lit;
+		}
+	default:
+		return "NULL";
+	}
+}
+
+string SqlBulkBuilder::insertRow( const SqlStmtParameters& row, const ConcreteDatabase& db ) const
+{
+	string out = _tupleParts[0];
+	for (size_t i=0;i<row.boundParams();i++)
+		out += literal(row.param(i),db) + _tupleParts[i+1];
+
+	return out;
+}
+
+string SqlBulkBuilder::updateRow( const SqlStmtParameters& row, bool first, const ConcreteDatabase& db ) const
+{
+	//the first select of the union names the columns
+	string out = "select ";
+	for (size_t i=0;i<row.boundParams();i++)
+	{
+		if (i > 0)
+			out += ", ";
+		out += literal(row.param(i),db);
+		if (first)
+			out += " as `p" + lexical_cast<string>(i) + "`";
+	}
+	return out;
+}
+
+void SqlBulkBuilder::build( const vector<SqlStmtParameters>& rows, size_t maxBytes, const ConcreteDatabase& db, vector<string>& out ) const
+{
+	if (_kind == BULK_INSERT)
+	{
+		string sql;
+		for (size_t i=0;i<rows.size();i++)
+		{
+			string tuple = insertRow(rows[i],db);
+			if (sql.length() > 0 && sql.length() + tuple.length() + _tail.length() + 2 > maxBytes)
+			{
+				out.push_back(sql + _tail);
+				sql.clear();
+			}
+
+			if (sql.empty())
+				sql = _head + tuple;
+			else
+				sql += ", " + tuple;
+		}
+		if (sql.length() > 0)
+			out.push_back(sql + _tail);
+	}
+	else if (_kind == BULK_UPDATE)
+	{
+		//a row joined twice would be updated from either one, so only the last row for each key is kept
+		vector<size_t> keep;
+		{
+			std::set<string> seenKeys;
+			for (size_t i=rows.size();i-->0;)
+			{
+				string key;
+				for (size_t k=_setCols.size();k<rows[i].boundParams();k++)
+					key += literal(rows[i].param(k),db) + ",";
+
+				if (seenKeys.insert(key).second)
+					keep.push_back(i);
+			}
+			std::reverse(keep.begin(),keep.end());
+		}
+
+		string head = "update `" + _table + "` t join (";
+		string foot = ") u on ";
+		for (size_t k=0;k<_keyCols.size();k++)
+		{
+			if (k > 0)
+				foot += " and ";
+			foot += "t.`" + _keyCols[k] + "` = u.`p" + lexical_cast<string>(_setCols.size()+k) + "`";
+		}
+		foot += " set ";
+		for (size_t c=0;c<_setCols.size();c++)
+		{
+			if (c > 0)
+				foot += ", ";
+			foot += "t.`" + _setCols[c] + "` = u.`p" + lexical_cast<string>(c) + "`";
+		}
+
+		string derived;
+		for (size_t i=0;i<keep.size();i++)
+		{
+			const SqlStmtParameters& row = rows[keep[i]];
+			string select = updateRow(row,derived.empty(),db);
+			if (derived.length() > 0 && head.length() + derived.length() + select.length() + foot.length() + 11 > maxBytes)
+			{
+				out.push_back(head + derived + foot);
+				derived.clear();
+				select = updateRow(row,true,db);
+			}
+
+			if (derived.length() > 0)
+				derived += " union all ";
+			derived += select;
+		}
+		if (derived.length() > 0)
+			out.push_back(head + derived + foot);
+	}
+}
@@ -0,0 +1,59 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+#include "Database/SqlStatement.h"
+
+class ConcreteDatabase;
+
+//turns rows of parameters for one prepared statement into a few multi-row statements
+//INSERT ... VALUES (?, ...) gets one tuple per row, UPDATE t SET a = ?, ... WHERE k = ? [AND ...]
+//becomes an update joined against a derived table of the rows
+class SqlBulkBuilder
+{
+public:
+	SqlBulkBuilder() : _kind(BULK_NONE) {}
+
+	//false if the statement isn't one of the above shapes, its rows then have to be executed one by one
+	bool parse(const char* sqlText, size_t numArgs);
+	//statements are split so that each stays under maxBytes, unless a single row is already larger
+	void build(const vector<SqlStmtParameters>& rows, size_t maxBytes, const ConcreteDatabase& db, vector<string>& out) const;
+private:
+	string literal(const SqlStmtField& data, const ConcreteDatabase& db) const;
+	string insertRow(const SqlStmtParameters& row, const ConcreteDatabase& db) const;
+	string updateRow(const SqlStmtParameters& row, bool first, const ConcreteDatabase& db) const;
+
+	enum Kind
+	{
+		BULK_NONE,
+		BULK_INSERT,
+		BULK_UPDATE
+	} _kind;
+
+	//insert: everything up to the values tuple, the tuple split at its placeholders, and whatever follows it
+	string _head;
+	vector<string> _tupleParts;
+	string _tail;
+
+	//update: table, assigned columns and key columns, in placeholder order
+	string _table;
+	vector<string> _setCols;
+	vector<string> _keyCols;
+};
\ No newline at end of file
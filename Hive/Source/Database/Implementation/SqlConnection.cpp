@@ -19,6 +19,7 @@
 #include "SqlConnection.h"
 #include "ConcreteDatabase.h"
 #include "SqlPreparedStatement.h"
+#include "Database/QueryResult.h"
 
 #include <sstream>
 
@@ -116,6 +117,23 @@ bool SqlConnection::executeStmt( const SqlStatementID& stId, const SqlStmtParame
 	}
 }
 
+unique_ptr<QueryResult> SqlConnection::queryStmt( const SqlStatementID& stId, const SqlStmtParameters& params )
+{
+	if(!stId.isInitialized())
+		return nullptr;
+
+	SqlPreparedStatement* pStmt = getStmt(stId);
+	pStmt->bind(params);
+	try { return pStmt->query(); }
+	catch(const SqlException& e)
+	{
+		if (e.isConnLost() || e.isRepeatable())
+			_stmtHolder.releasePrepStmtObj(stId.getId());
+
+		throw e;
+	}
+}
+
 size_t SqlConnection::escapeString( char* to, const char* from, size_t length ) const
 {
 	strncpy(to,from,length); 
@@ -64,10 +64,14 @@ public:
 
 	//called to make sure we are connected (after it breaks, etc)
 	virtual void connect() = 0;
+	//drop the server connection, connect() brings it back
+	virtual void disconnect() { clear(); }
 
 	//public methods for making queries
 	virtual unique_ptr<QueryResult> query(const char* sql) = 0;
 	virtual unique_ptr<QueryNamedResult> namedQuery(const char* sql) = 0;
+	//the connection can't be used for anything else until the result is done with
+	virtual unique_ptr<QueryResult> queryStreamed(const char* sql) { return query(sql); }
 
 	//public methods for making requests
 	virtual bool execute(const char* sql) = 0;
@@ -83,12 +87,16 @@ public:
 
 	//methods to work with prepared statements
 	bool executeStmt(const SqlStatementID& stId, const SqlStmtParameters& id);
+	unique_ptr<QueryResult> queryStmt(const SqlStatementID& stId, const SqlStmtParameters& id);
 
 	//SqlConnection object lock
 	class Lock
 	{
 	public:
 		Lock(SqlConnection& conn) : _lockedConn(conn) { _lockedConn._connLock.lock(); }
+		//takes over a connection that's already locked (tryLock)
+		enum AdoptTag { ADOPT };
+		Lock(SqlConnection& conn, AdoptTag) : _lockedConn(conn) {}
 		~Lock() { _lockedConn._connLock.unlock(); }
 
 		SqlConnection* operator->() const { return &_lockedConn; }
@@ -96,6 +104,11 @@ public:
 		SqlConnection& _lockedConn;
 	};
 
+	//for picking an idle connection out of a pool, Lock is the usual way
+	bool tryLock() { return _connLock.tryLock(); }
+	void lock() { _connLock.lock(); }
+	void unlock() { _connLock.unlock(); }
+
 	ConcreteDatabase& getDB() { return *_dbEngine; }
 	//allocate and return prepared statement object
 	SqlPreparedStatement* getStmt(const SqlStatementID& stId);
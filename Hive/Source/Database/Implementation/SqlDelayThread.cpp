@@ -19,11 +19,29 @@
 #include "SqlDelayThread.h"
 #include "Database/Database.h"
 #include "SqlOperations.h"
+#include "SqlConnection.h"
+#include "Shared/Common/Timer.h"
 
+#include <Poco/Format.h>
 #include <Poco/Thread.h>
 
-SqlDelayThread::SqlDelayThread(Database& db, SqlConnection& conn) : _dbEngine(db), _dbConn(conn), _isRunning(true)
+namespace
 {
+	//even when idle, wake up now and then to keep the stats moving
+	const long IDLE_WAIT_MS = 1000;
+	const UInt32 STATS_WINDOW_MS = 10*1000;
+	const UInt32 STATS_LOG_MS = 60*1000;
+};
+
+SqlDelayThread::SqlDelayThread(Database& db, SqlConnection& conn, Poco::Logger& logger) : _dbEngine(db), _dbConn(conn), _logger(logger), _isRunning(true),
+	_minBatch(1), _maxLingerMS(0), _groupMaxOps(1), _groupMaxMS(0), _groupFirstQueued(0), _statsWindowOps(0)
+{
+	_stats.maxOpAgeMS = 0;
+	_stats.opsPerSec = 0;
+	_stats.executed = 0;
+	_statsWindowStart = _lastStatsLog = GlobalTimer::getMSTime();
+	_queuedOps = 0;
+	_doneOps = 0;
 }
 
 SqlDelayThread::~SqlDelayThread()
@@ -34,35 +52,227 @@ SqlDelayThread::~SqlDelayThread()
     processRequests();
 }
 
+bool SqlDelayThread::queueOperation( SqlOperation* sql )
+{
+	QueuedOp queued;
+	queued.op = sql;
+	queued.queuedAt = GlobalTimer::getMSTime();
+	++_queuedOps;
+	_sqlQueue.push(queued);
+	++_queueDepth;
+	_wakeEvent.set();
+	return true; 
+}
+
+void SqlDelayThread::setPolicy( size_t minBatch, UInt32 maxLingerMS )
+{
+	_minBatch = std::max(minBatch,size_t(1));
+	_maxLingerMS = maxLingerMS;
+}
+
+void SqlDelayThread::setGroupCommit( size_t maxOps, UInt32 maxMS )
+{
+	_groupMaxOps = std::max(maxOps,size_t(1));
+	_groupMaxMS = maxMS;
+}
+
 void SqlDelayThread::run()
 {
 	_dbEngine.threadEnter();
 
-    const size_t loopSleepMS = 10;
-
+	bool lingering = false;
+	UInt32 lingerStart = 0;
     while (_isRunning)
     {
-        //if the running state gets turned off while sleeping
-        //empty the queue before exiting
-        Poco::Thread::sleep(loopSleepMS);
+		//the event stays signalled if something got queued after this check
+		size_t depth = std::max(_queueDepth.value(),0);
+		if (depth == 0)
+		{
+			lingering = false;
+			_wakeEvent.tryWait(IDLE_WAIT_MS);
+			updateStats(0,0);
+			continue;
+		}
+
+		//hold off on a small batch for a bit, more might be on the way
+		UInt32 maxLinger = _maxLingerMS;
+		if (depth < _minBatch && maxLinger > 0)
+		{
+			UInt32 now = GlobalTimer::getMSTime();
+			if (!lingering)
+			{
+				lingering = true;
+				lingerStart = now;
+			}
+			UInt32 waited = GlobalTimer::getMSTimeDiff(lingerStart,now);
+			if (waited < maxLinger)
+			{
+				_wakeEvent.tryWait(maxLinger - waited);
+				continue;
+			}
+		}
+		lingering = false;
 
         processRequests();
     }
 
+	//if the running state got turned off while waiting, empty the queue before exiting
+	processRequests();
+
 	_dbEngine.threadExit();
 }
 
 void SqlDelayThread::stop()
 {
     _isRunning = false;
+	_wakeEvent.set();
 }
 
 void SqlDelayThread::processRequests()
 {
-    SqlOperation* s = nullptr;
-    while (_sqlQueue.try_pop(s))
+	size_t numOps = 0;
+	UInt32 maxAge = 0;
+
+    QueuedOp queued;
+    while (_sqlQueue.try_pop(queued))
     {
-        s->execute(_dbConn);
-        s->onRemove();
+		--_queueDepth;
+		maxAge = std::max(maxAge,GlobalTimer::getMSTimeDiff(queued.queuedAt,GlobalTimer::getMSTime()));
+		numOps++;
+
+		size_t groupMax = _groupMaxOps;
+		if (groupMax <= 1 || !queued.op->canGroup())
+		{
+			//whatever was grouped so far was queued first, so it goes first
+			executeGroup();
+
+			queued.op->execute(_dbConn);
+			queued.op->onRemove();
+			++_doneOps;
+			continue;
+		}
+
+		if (!_group.empty() && GlobalTimer::getMSTimeDiff(_groupFirstQueued,queued.queuedAt) > _groupMaxMS)
+			executeGroup();
+
+		if (_group.empty())
+			_groupFirstQueued = queued.queuedAt;
+		_group.push_back(queued.op);
+
+		if (_group.size() >= groupMax)
+			executeGroup();
     }
+	executeGroup();
+
+	if (numOps > 0)
+		updateStats(numOps,maxAge);
+}
+
+void SqlDelayThread::executeGroup()
+{
+	if (_group.empty())
+		return;
+
+	if (_group.size() == 1)
+	{
+		_group[0]->execute(_dbConn);
+		_group[0]->onRemove();
+		_group.clear();
+		return;
+	}
+
+	//one transaction is one log flush, instead of one for every write
+	bool committed = false;
+	bool replay = true;
+	{
+		SqlConnection::Lock guard(_dbConn);
+		bool commitSent = false;
+		try
+		{
+			_dbConn.transactionStart();
+
+			bool allOk = true;
+			for (size_t i=0; i<_group.size() && allOk; i++)
+				allOk = _group[i]->executeOnce(_dbConn);
+
+			if (allOk)
+			{
+				commitSent = true;
+				committed = _dbConn.transactionCommit();
+			}
+			else
+				_dbConn.transactionRollback();
+		}
+		catch (const SqlConnection::SqlException& e)
+		{
+			e.toLog(_logger);
+
+			//with the commit reply lost there's no telling if it went through, and replaying could apply the writes twice
+			if (commitSent && e.isConnLost())
+			{
+				_logger.error(Poco::format("Lost connection during group commit, %z writes may not have been saved",_group.size()));
+				replay = false;
+			}
+
+			try
+			{
+				if (e.isConnLost())
+					_dbConn.connect();
+				else
+					_dbConn.transactionRollback();
+			}
+			catch (const SqlConnection::SqlException& e2)
+			{
+				e2.toLog(_logger);
+			}
+		}
+	}
+
+	if (!committed && replay)
+	{
+		//nothing got committed, so run them one by one with the usual retries
+		_logger.warning(Poco::format("Group commit of %z writes failed, retrying individually",_group.size()));
+		for (size_t i=0; i<_group.size(); i++)
+			_group[i]->execute(_dbConn);
+	}
+
+	for (size_t i=0; i<_group.size(); i++)
+		_group[i]->onRemove();
+	_doneOps += _group.size();
+	_group.clear();
+}
+
+void SqlDelayThread::updateStats( size_t numOps, UInt32 maxAgeMS )
+{
+	UInt32 now = GlobalTimer::getMSTime();
+	if (numOps > 0)
+	{
+		_stats.executed += numOps;
+		_stats.maxOpAgeMS = std::max(_stats.maxOpAgeMS,maxAgeMS);
+		_statsWindowOps += numOps;
+	}
+
+	UInt32 windowMS = GlobalTimer::getMSTimeDiff(_statsWindowStart,now);
+	if (windowMS >= STATS_WINDOW_MS)
+	{
+		_stats.opsPerSec = double(_statsWindowOps) * 1000.0 / windowMS;
+		_statsWindowOps = 0;
+		_statsWindowStart = now;
+	}
+
+	if (GlobalTimer::getMSTimeDiff(_lastStatsLog,now) < STATS_LOG_MS)
+		return;
+
+	_lastStatsLog = now;
+	if (_stats.executed > 0 && _logger.debug())
+	{
+		//there's one of these per async writer
+		Poco::Thread* thread = Poco::Thread::current();
+		string queueName = thread ? thread->name() : "Async queue";
+		size_t depth = std::max(_queueDepth.value(),0);
+		_logger.debug(Poco::format("%s: depth %z, %.1f ops/s, max op age %ums, %Lu executed",
+			queueName,depth,_stats.opsPerSec,_stats.maxOpAgeMS,_stats.executed));
+	}
+	//the max age is per log period
+	_stats.maxOpAgeMS = 0;
 }
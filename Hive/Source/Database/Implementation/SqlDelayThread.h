@@ -18,35 +18,78 @@
 
 #pragma once
 
+#include "Database/Database.h"
+
 #include <tbb/concurrent_queue.h>
+#include <tbb/atomic.h>
 #include <Poco/Runnable.h>
+#include <Poco/Event.h>
+#include <Poco/AtomicCounter.h>
 
-class Database;
 class SqlOperation;
 class SqlConnection;
 
 class SqlDelayThread : public Poco::Runnable
 {
 protected:
-	typedef tbb::concurrent_queue<SqlOperation*> SqlQueue;
+	struct QueuedOp
+	{
+		SqlOperation* op;
+		UInt32 queuedAt;
+	};
+	typedef tbb::concurrent_queue<QueuedOp> SqlQueue;
 
 	SqlQueue _sqlQueue;			//Queue of SQL statements
 	Database& _dbEngine;		//Pointer to used Database engine
 	SqlConnection& _dbConn;		//Pointer to DB connection
+	Poco::Logger& _logger;
 	volatile bool _isRunning;
 
+	//signalled on every enqueue and on stop, so an idle thread sleeps until there's work
+	Poco::Event _wakeEvent;
+	Poco::AtomicCounter _queueDepth;
+	//counted before pushing and after running, so an op is done once _doneOps reaches the count taken when it was queued
+	tbb::atomic<UInt64> _queuedOps;
+	tbb::atomic<UInt64> _doneOps;
+
+	//wait for at least this many operations, unless the oldest has waited maxLinger
+	volatile size_t _minBatch;
+	volatile UInt32 _maxLingerMS;
+
+	//up to this many writes, queued within groupMS of each other, are committed as one transaction
+	volatile size_t _groupMaxOps;
+	volatile UInt32 _groupMaxMS;
+	vector<SqlOperation*> _group;
+	UInt32 _groupFirstQueued;
+	//runs and releases everything in _group
+	void executeGroup();
+
+	//only touched by the thread itself, logged at debug
+	struct QueueStats
+	{
+		UInt32 maxOpAgeMS; //time from queueing to execution, since the last stats log
+		double opsPerSec;
+		UInt64 executed;
+	};
+	QueueStats _stats;
+	UInt32 _statsWindowStart;
+	UInt64 _statsWindowOps;
+	UInt32 _lastStatsLog;
+	void updateStats(size_t numOps, UInt32 maxAgeMS);
+
 	//process all enqueued requests
 	virtual void processRequests();
 public:
-	SqlDelayThread(Database& db, SqlConnection& conn);
+	SqlDelayThread(Database& db, SqlConnection& conn, Poco::Logger& logger);
 	virtual ~SqlDelayThread();
 
 	//Put sql statement to delay queue
-	bool queueOperation(SqlOperation* sql) 
-	{
-		_sqlQueue.push(sql);
-		return true; 
-	}
+	bool queueOperation(SqlOperation* sql);
+
+	void setPolicy(size_t minBatch, UInt32 maxLingerMS);
+	void setGroupCommit(size_t maxOps, UInt32 maxMS);
+	UInt64 queuedOps() const { return _queuedOps; }
+	UInt64 doneOps() const { return _doneOps; }
 
 	//Send stop event
 	virtual void stop();
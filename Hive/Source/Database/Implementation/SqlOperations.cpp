@@ -42,10 +42,47 @@ bool SqlPlainRequest::rawExecute(SqlConnection& sqlConn)
 	return Retry::SqlOp<bool>(sqlConn.getDB().getLogger(),[&](SqlConnection& c){ return c.execute(_sql.c_str()); })(sqlConn,"PlainRequest",[&](){ return _sql; });
 }
 
+bool SqlPlainRequest::executeOnce(SqlConnection& sqlConn)
+{
+	return sqlConn.execute(_sql.c_str());
+}
+
+void SqlPlainRequest::onRemove()
+{
+	if (_pool)
+		_pool->release(this);
+	else
+		delete this;
+}
+
+bool SqlSplitRequest::rawExecute(SqlConnection& sqlConn)
+{
+	Poco::Logger& logger = sqlConn.getDB().getLogger();
+	if (Retry::SqlOp<bool>(logger,[&](SqlConnection& c){ return c.execute(_sql.c_str()); })(sqlConn,"SplitRequest",[&](){ return _sql; }))
+		return true;
+
+	logger.warning(Poco::format("Batched statement failed, retrying its %z parts individually",_fallbacks.size()));
+	bool allOk = true;
+	for (size_t i=0; i<_fallbacks.size(); i++)
+	{
+		const std::string& sql = _fallbacks[i];
+		if (!Retry::SqlOp<bool>(logger,[&](SqlConnection& c){ return c.execute(sql.c_str()); })(sqlConn,"SplitRequest",[&](){ return sql; }))
+			allOk = false;
+	}
+	return allOk;
+}
+
+bool SqlSplitRequest::executeOnce(SqlConnection& sqlConn)
+{
+	return sqlConn.execute(_sql.c_str());
+}
+
 SqlTransaction::~SqlTransaction()
 {
-	while(!_queue.empty())
-		_queue.pop_back();
+	for (size_t i=0; i<_queue.size(); i++)
+		_queue[i]->onRemove();
+
+	_queue.clear();
 }
 
 bool SqlTransaction::rawExecute(SqlConnection& sqlConn)
@@ -58,7 +95,7 @@ bool SqlTransaction::rawExecute(SqlConnection& sqlConn)
 	const size_t nItems = _queue.size();
 	for (size_t i=0; i<nItems; i++)
 	{
-		SqlOperation& stmt = _queue[i];
+		SqlOperation& stmt = *_queue[i];
 
 		if(!stmt.rawExecute(sqlConn))
 		{
@@ -75,6 +112,134 @@ bool SqlPreparedRequest::rawExecute(SqlConnection& sqlConn)
 	return Retry::SqlOp<bool>(sqlConn.getDB().getLogger(),[&](SqlConnection& c){ return c.executeStmt(_id, _params); })(sqlConn,"PreparedRequest",[&](){ return sqlConn.getStmt(_id)->getSqlString(true); });
 }
 
+bool SqlPreparedRequest::executeOnce(SqlConnection& sqlConn)
+{
+	return sqlConn.executeStmt(_id, _params);
+}
+
+void SqlPreparedRequest::onRemove()
+{
+	if (_pool)
+		_pool->release(this);
+	else
+		delete this;
+}
+
+// ---- OPERATION POOL ----
+SqlOpPool::SqlOpPool()
+{
+	//reserved up front, so handing things back never reallocates
+	_freePlain.reserve(MAX_FREE_OPS);
+	_freePrepared.reserve(MAX_FREE_OPS);
+	_freeParams.reserve(MAX_FREE_PARAMS);
+}
+
+SqlOpPool::~SqlOpPool()
+{
+	for (size_t i=0; i<_freePlain.size(); i++)
+		delete _freePlain[i];
+	for (size_t i=0; i<_freePrepared.size(); i++)
+		delete _freePrepared[i];
+}
+
+SqlPlainRequest* SqlOpPool::plainRequest( const char* sql )
+{
+	SqlPlainRequest* op = nullptr;
+	{
+		GuardType guard(_plainLock);
+		if (!_freePlain.empty())
+		{
+			op = _freePlain.back();
+			_freePlain.pop_back();
+		}
+	}
+	if (!op)
+		op = new SqlPlainRequest(*this);
+
+	op->_sql.assign(sql);
+	return op;
+}
+
+SqlPreparedRequest* SqlOpPool::preparedRequest( const SqlStatementID& stId, SqlStmtParameters& params )
+{
+	SqlPreparedRequest* op = nullptr;
+	{
+		GuardType guard(_preparedLock);
+		if (!_freePrepared.empty())
+		{
+			op = _freePrepared.back();
+			_freePrepared.pop_back();
+		}
+	}
+	if (!op)
+		op = new SqlPreparedRequest(*this);
+
+	//the caller gets the request's emptied buffer in exchange
+	op->_id = stId;
+	op->_params.swap(params);
+	return op;
+}
+
+void SqlOpPool::release( SqlPlainRequest* op )
+{
+	if (op->_sql.capacity() > MAX_KEPT_BYTES)
+		std::string().swap(op->_sql);
+	else
+		op->_sql.clear();
+
+	{
+		GuardType guard(_plainLock);
+		if (_freePlain.size() < _freePlain.capacity())
+		{
+			_freePlain.push_back(op);
+			return;
+		}
+	}
+	delete op;
+}
+
+void SqlOpPool::release( SqlPreparedRequest* op )
+{
+	if (op->_params.capacity() > MAX_KEPT_BYTES)
+		SqlStmtParameters().swap(op->_params);
+	else
+		op->_params.reset();
+
+	{
+		GuardType guard(_preparedLock);
+		if (_freePrepared.size() < _freePrepared.capacity())
+		{
+			_freePrepared.push_back(op);
+			return;
+		}
+	}
+	delete op;
+}
+
+void SqlOpPool::takeParams( SqlStmtParameters& params )
+{
+	GuardType guard(_paramsLock);
+	if (!_freeParams.empty())
+	{
+		params.swap(_freeParams.back());
+		_freeParams.pop_back();
+	}
+}
+
+void SqlOpPool::returnParams( SqlStmtParameters& params )
+{
+	if (params.capacity() < 1 || params.capacity() > MAX_KEPT_BYTES)
+		return;
+
+	params.reset();
+	GuardType guard(_paramsLock);
+	if (_freeParams.size() < _freeParams.capacity())
+	{
+		_freeParams.push_back(SqlStmtParameters());
+		_freeParams.back().swap(params);
+	}
+}
+
 // ---- ASYNC QUERIES ----
 bool SqlQuery::rawExecute(SqlConnection& sqlConn)
 {
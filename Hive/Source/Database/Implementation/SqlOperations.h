@@ -22,7 +22,7 @@
 #include "Database/Callback.h"
 #include "Database/SqlStatement.h"
 
-#include <boost/ptr_container/ptr_vector.hpp>
+#include <Poco/Mutex.h>
 #include <tbb/concurrent_queue.h>
 
 // ---- BASE ---
@@ -31,6 +31,7 @@ class Database;
 class SqlConnection;
 class SqlDelayThread;
 class SqlStmtParameters;
+class SqlOpPool;
 
 class SqlOperation
 {
@@ -38,6 +39,11 @@ public:
 	virtual void onRemove() { delete this; }
 	bool execute(SqlConnection& sqlConn);
 	virtual ~SqlOperation() {}
+
+	//plain writes can share a transaction with their neighbours on the delay thread
+	virtual bool canGroup() const { return false; }
+	//one attempt on an already locked connection, errors are thrown instead of retried
+	virtual bool executeOnce(SqlConnection& sqlConn) { return rawExecute(sqlConn); }
 protected:
 	friend class SqlTransaction;
 	virtual bool rawExecute(SqlConnection& sqlConn) = 0;
@@ -48,12 +54,38 @@ protected:
 class SqlPlainRequest : public SqlOperation
 {
 public:
-	SqlPlainRequest(std::string sql) : _sql(std::move(sql)) {};
+	SqlPlainRequest(std::string sql) : _sql(std::move(sql)), _pool(nullptr) {};
 	~SqlPlainRequest() {};
+
+	void onRemove() override;
+	bool canGroup() const override { return true; }
+	bool executeOnce(SqlConnection& sqlConn) override;
+protected:
+	bool rawExecute(SqlConnection& sqlConn) override;
+private:
+	friend class SqlOpPool;
+	SqlPlainRequest(SqlOpPool& pool) : _pool(&pool) {}
+
+	std::string _sql;
+	SqlOpPool* _pool;
+};
+
+//one batched statement, with the statements it stands for run one by one if it fails
+//so a single bad row can't take the rest of the batch down with it
+class SqlSplitRequest : public SqlOperation
+{
+public:
+	SqlSplitRequest(std::string sql, const std::vector<std::string>& fallbacks) : _sql(std::move(sql)), _fallbacks(fallbacks) {};
+	~SqlSplitRequest() {};
+
+	//inside a group only the batch is tried, a failed group re-runs this on its own with the fallbacks
+	bool canGroup() const override { return true; }
+	bool executeOnce(SqlConnection& sqlConn) override;
 protected:
 	bool rawExecute(SqlConnection& sqlConn) override;
 private:
 	std::string _sql;
+	std::vector<std::string> _fallbacks;
 };
 
 class SqlTransaction : public SqlOperation
@@ -66,19 +98,61 @@ public:
 protected:
 	bool rawExecute(SqlConnection& sqlConn) override;
 private:
-	boost::ptr_vector<SqlOperation> _queue;
+	//owned, released through onRemove so pooled requests go back to their pool
+	std::vector<SqlOperation*> _queue;
 };
 
 class SqlPreparedRequest : public SqlOperation
 {
 public:
-	SqlPreparedRequest(const SqlStatementID& stId, SqlStmtParameters& arg) : _id(stId) { _params.swap(arg); }
+	SqlPreparedRequest(const SqlStatementID& stId, SqlStmtParameters& arg) : _id(stId), _pool(nullptr) { _params.swap(arg); }
 	~SqlPreparedRequest() {}
+
+	void onRemove() override;
+	bool canGroup() const override { return true; }
+	bool executeOnce(SqlConnection& sqlConn) override;
 protected:
 	bool rawExecute(SqlConnection& sqlConn) override;
 private:
+	friend class SqlOpPool;
+	SqlPreparedRequest(SqlOpPool& pool) : _pool(&pool) {}
+
 	SqlStatementID _id;
 	SqlStmtParameters _params;
+	SqlOpPool* _pool;
+};
+
+//recycles async write requests and statement parameter buffers,
+//so once warmed up queueing a write doesn't touch the heap
+class SqlOpPool
+{
+public:
+	SqlOpPool();
+	~SqlOpPool();
+
+	//takes over the sql/params, the returned request goes back to the pool in onRemove
+	SqlPlainRequest* plainRequest(const char* sql);
+	SqlPreparedRequest* preparedRequest(const SqlStatementID& stId, SqlStmtParameters& params);
+
+	void release(SqlPlainRequest* op);
+	void release(SqlPreparedRequest* op);
+
+	//statements borrow a grown parameter buffer for as long as they live
+	void takeParams(SqlStmtParameters& params);
+	void returnParams(SqlStmtParameters& params);
+private:
+	//anything bigger than MAX_KEPT_BYTES (huge inventories) is freed instead of hogging the pool
+	enum { MAX_FREE_OPS = 1024, MAX_FREE_PARAMS = 64, MAX_KEPT_BYTES = 64*1024 };
+
+	typedef Poco::FastMutex LockType;
+	typedef Poco::ScopedLock<LockType> GuardType;
+
+	LockType _plainLock;
+	std::vector<SqlPlainRequest*> _freePlain;
+	LockType _preparedLock;
+	std::vector<SqlPreparedRequest*> _freePrepared;
+	LockType _paramsLock;
+	std::vector<SqlStmtParameters> _freeParams;
 };
 
 // ---- ASYNC QUERIES ----
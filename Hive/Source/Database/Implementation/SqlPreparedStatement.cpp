@@ -19,6 +19,7 @@
 #include "SqlPreparedStatement.h"
 #include "Database/Database.h"
 #include "SqlConnection.h"
+#include "Database/QueryResult.h"
 
 #include <Poco/String.h>
 
@@ -52,10 +53,9 @@ void SqlPlainPreparedStatement::bind( const SqlStmtParameters& holder )
 	_preparedSql = _stmtSql;
 	size_t nLastPos = 0;
 
-	const SqlStmtParameters::ParameterContainer& holderArgs = holder.params();
-	for (auto it=holderArgs.cbegin(); it!=holderArgs.cend(); ++it)
+	for (size_t i=0; i<holder.boundParams(); i++)
 	{
-		const SqlStmtField& data = (*it);
+		SqlStmtField data = holder.param(i);
 
 		nLastPos = _preparedSql.find('?', nLastPos);
 		if(nLastPos != std::string::npos)
@@ -81,6 +81,16 @@ bool SqlPlainPreparedStatement::execute()
 	return _conn.execute(_preparedSql.c_str());
 }
 
+unique_ptr<QueryResult> SqlPlainPreparedStatement::query()
+{
+	poco_assert(isPrepared());
+
+	if (_preparedSql.empty())
+		return nullptr;
+
+	return _conn.query(_preparedSql.c_str());
+}
+
 std::string SqlPlainPreparedStatement::getSqlString( bool withValues/*=false*/ ) const 
 {
 	if (withValues)
@@ -23,6 +23,7 @@
 class SqlConnection;
 class SqlStmtField;
 class SqlStmtParameters;
+class QueryResult;
 
 //base prepared statement class
 class SqlPreparedStatement
@@ -44,6 +45,8 @@ public:
 
 	//execute statement w/o result set
 	virtual bool execute() = 0;
+	//execute a SELECT, the rows are owned by the result so the statement can be reused right away
+	virtual unique_ptr<QueryResult> query() = 0;
 
 	virtual int lastError() const { return 0; }
 	virtual std::string lastErrorDescr() const { return ""; }
@@ -84,6 +87,7 @@ public:
 	void bind(const SqlStmtParameters& holder) override;
 
 	bool execute() override;
+	unique_ptr<QueryResult> query() override;
 
 	std::string getSqlString(bool withValues=false) const override;
 protected:
@@ -23,6 +23,19 @@
 
 //////////////////////////////////////////////////////////////////////////
 
+SqlStatementImpl::SqlStatementImpl( const SqlStatementID& index, ConcreteDatabase& db )
+{
+	_stmtId = index;
+	_dbEngine = &db;
+	_dbEngine->_opPool.takeParams(_params);
+	_params.reset(_stmtId.numArgs());
+}
+
+SqlStatementImpl::~SqlStatementImpl()
+{
+	_dbEngine->_opPool.returnParams(_params);
+}
+
 void SqlStatementImpl::verifyNumBoundParams( const SqlStmtParameters& args )
 {
 	//verify amount of bound parameters
@@ -34,16 +47,42 @@ void SqlStatementImpl::verifyNumBoundParams( const SqlStmtParameters& args )
 	}
 }
 
+//queued executions swap their own emptied buffer in, so the parameters are reset afterwards instead of detached
 bool SqlStatementImpl::execute()
 {
-	SqlStmtParameters args = detach();
-	verifyNumBoundParams(args);
-	return _dbEngine->executeStmt(_stmtId, args);
+	verifyNumBoundParams(_params);
+	size_t shard = _keyed ? _dbEngine->asyncShardOf(_shardKey) : 0;
+	bool res = _dbEngine->executeStmt(_stmtId, _params, shard);
+	_params.reset(numArgs());
+	return res;
 }
 
 bool SqlStatementImpl::directExecute()
 {
-	SqlStmtParameters args = detach();
-	verifyNumBoundParams(args);
-	return _dbEngine->directExecuteStmt(_stmtId, args);
+	verifyNumBoundParams(_params);
+	bool res = _dbEngine->directExecuteStmt(_stmtId, _params);
+	_params.reset(numArgs());
+	return res;
+}
+
+bool SqlStatementImpl::executeBulk()
+{
+	if (_params.boundParams() > 0)
+		addRow();
+
+	vector<SqlStmtParameters> rows;
+	rows.swap(_rows);
+	for (size_t i=0; i<rows.size(); i++)
+		verifyNumBoundParams(rows[i]);
+
+	size_t shard = _keyed ? _dbEngine->asyncShardOf(_shardKey) : 0;
+	return _dbEngine->executeBulkStmt(_stmtId, rows, shard);
+}
+
+unique_ptr<QueryResult> SqlStatementImpl::query()
+{
+	verifyNumBoundParams(_params);
+	auto res = _dbEngine->queryStmt(_stmtId, _params);
+	_params.reset(numArgs());
+	return res;
 }
\ No newline at end of file
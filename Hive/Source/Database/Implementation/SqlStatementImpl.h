@@ -29,15 +29,16 @@ public:
 	{
 		_stmtId = index._stmtId;
 		_dbEngine = index._dbEngine;
+		_keyed = index._keyed;
+		_shardKey = index._shardKey;
+		_rows = index._rows;
 
 		if(index._params.boundParams() > 0)
 			_params = index._params;
 		else
 			_params.reset(_stmtId.numArgs());
 	}
-	virtual ~SqlStatementImpl()
-	{
-	}
+	virtual ~SqlStatementImpl();
 
 	SqlStatementImpl& operator=( const SqlStatementImpl& index )
 	{
@@ -45,6 +46,9 @@ public:
 		{
 			_stmtId = index._stmtId;
 			_dbEngine = index._dbEngine;
+			_keyed = index._keyed;
+			_shardKey = index._shardKey;
+			_rows = index._rows;
 
 			if(index._params.boundParams() > 0)
 				_params = index._params;
@@ -56,22 +60,13 @@ public:
 	}
 	bool execute();
 	bool directExecute();
+	unique_ptr<QueryResult> query();
+	bool executeBulk();
 protected:
 	//don't allow anyone except Database class to create static SqlStatement objects
 	friend class ConcreteDatabase;
-	SqlStatementImpl(const SqlStatementID& index, ConcreteDatabase& db) 
-	{
-		_stmtId = index;
-		_dbEngine = &db;
-		_params.reset(_stmtId.numArgs());
-	}
+	SqlStatementImpl(const SqlStatementID& index, ConcreteDatabase& db);
 private:
-	inline SqlStmtParameters detach()
-	{
-		SqlStmtParameters retVal;
-		_params.swap(retVal);
-		return retVal;
-	}
 	void verifyNumBoundParams(const SqlStmtParameters& args);
 
 	ConcreteDatabase* _dbEngine;
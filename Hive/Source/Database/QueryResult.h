@@ -47,6 +47,8 @@ public:
 	virtual size_t numFields() const = 0;
 	//this will also return number of affected rows for non-SELECT statements
 	virtual UInt64 numRows() const = 0;
+	//streamed results can break off midway, check once fetchRow returns false
+	virtual bool incomplete() const { return false; }
 
 protected:
 	Field _dummyField;
@@ -65,6 +67,7 @@ public:
 
 	size_t numFields() const override { return _actualRes->numFields(); }
 	UInt64 numRows() const override { return _actualRes->numRows(); }
+	bool incomplete() const override { return _actualRes->incomplete(); }
 
 	//named access
 	const Field& operator[] (const std::string& name) const { return (*_actualRes)[fieldIdx(name)]; }
@@ -20,9 +20,11 @@
 
 #include "Shared/Common/Types.h"
 #include "Shared/Common/Exception.h"
-#include <boost/variant.hpp>
+#include <Poco/Bugcheck.h>
 #include <sstream>
+#include <cstring>
 
+//view of one bound parameter, only valid while its SqlStmtParameters is left alone
 class SqlStmtField
 {
 public:
@@ -44,199 +46,151 @@ public:
 		FIELD_COUNT
 	};
 
-	template<typename T>
-	SqlStmtField(T param) { set(param); }
-
-	SqlStmtField(const UInt8* data, size_t size) { set(data,size); }
-	SqlStmtField(const char* str, size_t size) { set(str,size); }
-
-	template<typename T1>
-	void set(T1 param1);
-
-	void set(std::string val);
-	void set(ByteVector val);
-	void set(const UInt8* data, size_t size);
-	void set(const char* str, size_t strSize);
+	SqlStmtField(Type type, const void* data, size_t size) : _type(type), _data(data), _size(size) {}
 
 	//getters
-	bool				toBool() const		{ return boost::get<bool>(_data); }
-	UInt8				toUint8() const		{ return boost::get<UInt8>(_data); }
-	Int8				toInt8() const		{ return boost::get<Int8>(_data); }
-	UInt16				toUint16() const	{ return boost::get<UInt16>(_data); }
-	Int16				toInt16() const		{ return boost::get<Int16>(_data); }
-	UInt32				toUint32() const	{ return boost::get<UInt32>(_data); }
-	Int32				toInt32() const		{ return boost::get<Int32>(_data); }
-	UInt64				toUint64() const	{ return boost::get<UInt64>(_data); }
-	Int64				toInt64() const		{ return boost::get<Int64>(_data); }
-	float				toFloat() const		{ return boost::get<float>(_data); }
-	double				toDouble() const	{ return boost::get<double>(_data); }
-	const std::string&	toString() const	{ return boost::get<const std::string&>(_data); }
-	const char*			toCStr() const		{ return toString().c_str(); }
-	const ByteVector&	toVector() const	{ return boost::get<const ByteVector&>(_data); }
+	bool				toBool() const		{ return get<bool>(FIELD_BOOL); }
+	UInt8				toUint8() const		{ return get<UInt8>(FIELD_UI8); }
+	Int8				toInt8() const		{ return get<Int8>(FIELD_I8); }
+	UInt16				toUint16() const	{ return get<UInt16>(FIELD_UI16); }
+	Int16				toInt16() const		{ return get<Int16>(FIELD_I16); }
+	UInt32				toUint32() const	{ return get<UInt32>(FIELD_UI32); }
+	Int32				toInt32() const		{ return get<Int32>(FIELD_I32); }
+	UInt64				toUint64() const	{ return get<UInt64>(FIELD_UI64); }
+	Int64				toInt64() const		{ return get<Int64>(FIELD_I64); }
+	float				toFloat() const		{ return get<float>(FIELD_FLOAT); }
+	double				toDouble() const	{ return get<double>(FIELD_DOUBLE); }
+	std::string			toString() const	{ poco_assert(_type == FIELD_STRING); return std::string(toCStr(),_size); }
+	//strings are stored with a terminator
+	const char*			toCStr() const		{ poco_assert(_type == FIELD_STRING); return static_cast<const char*>(_data); }
+	ByteVector			toVector() const
+	{
+		poco_assert(_type == FIELD_BINARY);
+		const UInt8* bytes = static_cast<const UInt8*>(_data);
+		return ByteVector(bytes,bytes+_size);
+	}
 
 	//get type of data
-	Type type() const 
-	{ 
-		struct TypeVisitor : public boost::static_visitor<Type>
-		{
-			Type operator ()(bool) const				{ return FIELD_BOOL; }
-			Type operator ()(UInt8) const				{ return FIELD_UI8; }
-			Type operator ()(Int8) const				{ return FIELD_I8; }
-			Type operator ()(UInt16) const				{ return FIELD_UI16; }
-			Type operator ()(Int16) const				{ return FIELD_I16; }
-			Type operator ()(UInt32) const				{ return FIELD_UI32; }
-			Type operator ()(Int32) const				{ return FIELD_I32; }
-			Type operator ()(UInt64) const				{ return FIELD_UI64; }
-			Type operator ()(Int64) const				{ return FIELD_I64; }
-			Type operator ()(float) const				{ return FIELD_FLOAT; }
-			Type operator ()(double) const				{ return FIELD_DOUBLE; }
-			Type operator ()(const std::string&) const	{ return FIELD_STRING; }
-			Type operator ()(const ByteVector&) const	{ return FIELD_BINARY; }
-		};
-
-		return boost::apply_visitor(TypeVisitor(),_data);
-	}
+	Type type() const { return _type; }
 	//get pointer to underlying data
-	const void* buff() const
-	{ 
-		struct BufferVisitor : public boost::static_visitor<const void*>
-		{
-			const void* operator ()(const bool& data) const			{ return &data; }
-			const void* operator ()(const UInt8& data) const		{ return &data; }
-			const void* operator ()(const Int8& data) const			{ return &data; }
-			const void* operator ()(const UInt16& data) const		{ return &data; }
-			const void* operator ()(const Int16& data) const		{ return &data; }
-			const void* operator ()(const UInt32& data) const		{ return &data; }
-			const void* operator ()(const Int32& data) const		{ return &data; }
-			const void* operator ()(const UInt64& data) const		{ return &data; }
-			const void* operator ()(const Int64& data) const		{ return &data; }
-			const void* operator ()(const float& data) const		{ return &data; }
-			const void* operator ()(const double& data) const		{ return &data; }
-			const void* operator ()(const std::string& data) const	{ return data.c_str(); }
-			const void* operator ()(const ByteVector& data) const	
-			{ 
-				if (data.size() > 0)
-					return &data[0];
-
-				return nullptr;
-			}
-		};
-
-		return boost::apply_visitor(BufferVisitor(), _data);
-	}
-
+	const void* buff() const { return _size > 0 || _type == FIELD_STRING ? _data : nullptr; }
 	//get size of data
-	size_t size() const
+	size_t size() const { return _size; }
+private:
+	template<typename T>
+	T get(Type expected) const
 	{
-		struct SizeVisitor : public boost::static_visitor<size_t>
-		{
-			size_t operator ()(bool) const						{ return sizeof(bool); }
-			size_t operator ()(UInt8) const						{ return sizeof(UInt8); }
-			size_t operator ()(Int8) const						{ return sizeof(Int8); }
-			size_t operator ()(UInt16) const					{ return sizeof(UInt16); }
-			size_t operator ()(Int16) const						{ return sizeof(Int16); }
-			size_t operator ()(UInt32) const					{ return sizeof(UInt32); }
-			size_t operator ()(Int32) const						{ return sizeof(Int32); }
-			size_t operator ()(UInt64) const					{ return sizeof(UInt64); }
-			size_t operator ()(Int64) const						{ return sizeof(Int64); }
-			size_t operator ()(float) const						{ return sizeof(float); }
-			size_t operator ()(double) const					{ return sizeof(double); }
-			size_t operator ()(const std::string& data) const	{ return data.length(); }
-			size_t operator ()(const ByteVector& data) const	{ return data.size(); }
-		};
-
-		return boost::apply_visitor(SizeVisitor(),_data);
+		poco_assert(_type == expected);
+		return *static_cast<const T*>(_data);
 	}
 
-private:
-	typedef boost::variant< std::string, ByteVector, 
-		bool, UInt8, UInt16, UInt32, UInt64, 
-		Int8, Int16, Int32, Int64, float, double > FieldVariant;
-
-	FieldVariant _data;
+	Type _type;
+	const void* _data;
+	size_t _size;
 };
 
-//template specialization
-template<> inline void SqlStmtField::set(bool val) { _data = val; }
-template<> inline void SqlStmtField::set(UInt8 val) { _data = val; }
-template<> inline void SqlStmtField::set(Int8 val) { _data = val; }
-template<> inline void SqlStmtField::set(UInt16 val) { _data = val; }
-template<> inline void SqlStmtField::set(Int16 val) { _data = val; }
-template<> inline void SqlStmtField::set(UInt32 val) { _data = val; }
-template<> inline void SqlStmtField::set(Int32 val) { _data = val; }
-template<> inline void SqlStmtField::set(UInt64 val) { _data = val; }
-template<> inline void SqlStmtField::set(Int64 val) { _data = val; }
-template<> inline void SqlStmtField::set(float val) { _data = val; }
-template<> inline void SqlStmtField::set(double val) { _data = val; }
-template<> inline void SqlStmtField::set(const char* val) { _data = std::string(val); }
-
-inline void SqlStmtField::set(std::string val) { _data = std::move(val); }
-inline void SqlStmtField::set(ByteVector val) { _data = std::move(val); }
-inline void SqlStmtField::set(const UInt8* data, size_t size) 
-{
-	ByteVector localData(size);
-	if (size>0)
-		std::copy(data,data+size,localData.begin());
-	_data = std::move(localData);
-}
-inline void SqlStmtField::set(const char* str, size_t strSize)
-{
-	if (strSize>0)
-		_data = std::string(str,strSize);
-	else
-		_data = std::string();
-}
-
 class SqlStatement;
+class QueryResult;
 //prepared statement executor
+//all values of a statement live in one buffer, fixed width ones inline and strings appended,
+//so a reused holder doesn't allocate once it has grown to fit
 class SqlStmtParameters
 {
 public:
-	typedef std::vector<SqlStmtField> ParameterContainer;
-
 	//reserve memory to contain all input parameters of stmt
 	void reserve(size_t numParams)
 	{
 		if(numParams > 0)
 		{
-			if (numParams > _params.capacity())
-				_params.reserve(numParams);
+			if (numParams > _slots.capacity())
+				_slots.reserve(numParams);
 		}
 	}
 
 	//get amount of bound parameters
 	size_t boundParams() const 
 	{
-		return _params.size();
+		return _slots.size();
 	}
-	//add parameter
-	void addParam(const SqlStmtField& data) 
+	//get bound parameter
+	SqlStmtField param(size_t idx) const
 	{
-		_params.push_back(data); 
+		const Slot& slot = _slots[idx];
+		return SqlStmtField(slot.type, _arena.empty() ? nullptr : &_arena[slot.offset], slot.size);
 	}
+	//bytes held by the value buffer
+	size_t capacity() const { return _arena.capacity(); }
+
+	//add parameter
+	void addParam(bool val)		{ addValue(SqlStmtField::FIELD_BOOL,val); }
+	void addParam(UInt8 val)	{ addValue(SqlStmtField::FIELD_UI8,val); }
+	void addParam(Int8 val)		{ addValue(SqlStmtField::FIELD_I8,val); }
+	void addParam(UInt16 val)	{ addValue(SqlStmtField::FIELD_UI16,val); }
+	void addParam(Int16 val)	{ addValue(SqlStmtField::FIELD_I16,val); }
+	void addParam(UInt32 val)	{ addValue(SqlStmtField::FIELD_UI32,val); }
+	void addParam(Int32 val)	{ addValue(SqlStmtField::FIELD_I32,val); }
+	void addParam(UInt64 val)	{ addValue(SqlStmtField::FIELD_UI64,val); }
+	void addParam(Int64 val)	{ addValue(SqlStmtField::FIELD_I64,val); }
+	void addParam(float val)	{ addValue(SqlStmtField::FIELD_FLOAT,val); }
+	void addParam(double val)	{ addValue(SqlStmtField::FIELD_DOUBLE,val); }
+	void addParam(const char* str) { addParam(str,strlen(str)); }
+	void addParam(const std::string& str) { addParam(str.c_str(),str.length()); }
+	void addParam(const char* str, size_t strSize) { addBytes(SqlStmtField::FIELD_STRING,str,strSize,true); }
+	void addParam(const ByteVector& data) { addParam(data.empty() ? nullptr : &data[0],data.size()); }
+	void addParam(const UInt8* data, size_t size) { addBytes(SqlStmtField::FIELD_BINARY,data,size,false); }
+
 	//empty SQL statement parameters. In case nParams > 0 - reserve memory for parameters
 	//should help to reuse the same object with batched SQL requests
 	void reset(size_t numArguments = 0)
 	{
-		_params.clear();
+		_slots.clear();
+		_arena.clear();
 		//reserve memory if needed
 		if(numArguments > 0)
-			_params.reserve(numArguments);
+			_slots.reserve(numArguments);
 	}
 	//swaps contents of internal param container
 	void swap(SqlStmtParameters& obj)
 	{
-		std::swap(_params, obj._params);
+		_slots.swap(obj._slots);
+		_arena.swap(obj._arena);
 	}
-	//get bound parameters
-	const ParameterContainer& params() const 
+private:
+	//fixed width values keep their natural alignment, the buffer itself comes from operator new
+	enum { VALUE_ALIGN = 8 };
+
+	template<typename T>
+	void addValue(SqlStmtField::Type type, T val)
 	{
-		return _params; 
+		size_t offset = (_arena.size() + VALUE_ALIGN - 1) & ~size_t(VALUE_ALIGN - 1);
+		_arena.resize(offset + sizeof(T));
+		memcpy(&_arena[offset],&val,sizeof(T));
+		pushSlot(type,offset,sizeof(T));
+	}
+	void addBytes(SqlStmtField::Type type, const void* data, size_t size, bool terminate)
+	{
+		size_t offset = _arena.size();
+		_arena.resize(offset + size + (terminate ? 1 : 0));
+		if (size > 0)
+			memcpy(&_arena[offset],data,size);
+		if (terminate)
+			_arena[offset+size] = 0;
+		pushSlot(type,offset,size);
+	}
+	void pushSlot(SqlStmtField::Type type, size_t offset, size_t size)
+	{
+		Slot slot = { type, offset, size };
+		_slots.push_back(slot);
 	}
 
-private:
-	//statement parameter holder
-	ParameterContainer _params;
+	struct Slot
+	{
+		SqlStmtField::Type type;
+		size_t offset;
+		size_t size;
+	};
+	std::vector<Slot> _slots;
+	std::vector<char> _arena;
 };
 
 //statement ID encapsulation logic
@@ -260,13 +214,33 @@ private:
 class SqlStatement
 {
 public:
+	SqlStatement() : _keyed(false), _shardKey(0) {}
 	virtual ~SqlStatement() {}
 
 	UInt32 getId() const { return _stmtId.getId(); }
 	size_t numArgs() const { return _stmtId.numArgs(); }
 
+	//async executions with the same key (characterId, objectId...) stay in order on one writer
+	//unkeyed statements all go through the first writer, so don't mix the two for one entity
+	void setShardKey(Int64 key) { _keyed = true; _shardKey = key; }
+	bool isKeyed() const { return _keyed; }
+	Int64 shardKey() const { return _shardKey; }
+
 	virtual bool execute() = 0;
 	virtual bool directExecute() = 0;
+	//synchronous SELECT on a pool connection, numeric columns come back without any text parsing
+	virtual unique_ptr<QueryResult> query() = 0;
+
+	//bulk execution: bind a row of parameters, addRow(), repeat, then executeBulk()
+	//INSERT ... VALUES and simple UPDATE ... SET `a` = ? WHERE `k` = ? statements are sent as a few multi-row ones
+	void addRow()
+	{
+		_rows.push_back(SqlStmtParameters());
+		_rows.back().swap(_params);
+	}
+	size_t numRows() const { return _rows.size(); }
+	//a row that's bound but not added yet goes along too
+	virtual bool executeBulk() = 0;
 
 	//templates to simplify 1-5 parameter bindings
 	template<typename ParamType1>
@@ -327,11 +301,11 @@ public:
 	void addFloat(float var) { arg(var); }
 	void addDouble(double var) { arg(var); }
 	void addString(const char* var) { arg(var); }
-	void addString(std::string var) { arg(std::move(var)); }
+	void addString(const std::string& var) { arg(var); }
 	void addString(std::ostringstream& ss) { arg(ss.str()); ss.str(std::string()); }
 	void addString(const char* var, size_t size)  { arg(var,size); }
 	void addBinary(const UInt8* data, size_t size) { arg(data,size); }
-	void addBinary(ByteVector data) { arg(std::move(data)); }
+	void addBinary(const ByteVector& data) { arg(data); }
 private:
 	SqlStmtParameters& get()
 	{
@@ -341,16 +315,19 @@ private:
 	//helper function
 	//use appropriate add* functions to bind specific data type
 	template<typename ParamType>
-	void arg(ParamType val)
+	void arg(const ParamType& val)
 	{
-		get().addParam(SqlStmtField(val));
+		get().addParam(val);
 	}
 	template<typename ParamType1, typename ParamType2>
-	void arg(ParamType1 val1, ParamType2 val2)
+	void arg(const ParamType1& val1, const ParamType2& val2)
 	{
-		get().addParam(SqlStmtField(val1,val2));
+		get().addParam(val1,val2);
 	}
 protected:
 	SqlStatementID _stmtId;
 	SqlStmtParameters _params;
+	std::vector<SqlStmtParameters> _rows;
+	bool _keyed;
+	Int64 _shardKey;
 };
\ No newline at end of file
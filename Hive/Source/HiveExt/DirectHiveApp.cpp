@@ -31,27 +31,53 @@ bool DirectHiveApp::initialiseService()
 	Poco::Logger& dbLogger = Poco::Logger::get("Database");
 
 	string initString;
+	size_t asyncMinBatch;
+	UInt32 asyncMaxLingerMS;
+	size_t asyncWriters;
+	size_t groupCommitOps;
+	UInt32 groupCommitMS;
+	size_t poolMin, poolMax;
+	UInt32 poolGrowWaitMS, poolHealthCheckSec;
 	{
 		Poco::AutoPtr<Poco::Util::AbstractConfiguration> globalDBConf(config().createView("Database"));
 		initString = DatabaseLoader::makeInitString(globalDBConf);
+		asyncMinBatch = std::max(globalDBConf->getInt("AsyncMinBatch",1),1);
+		asyncMaxLingerMS = std::max(globalDBConf->getInt("AsyncMaxLingerMS",0),0);
+		//writes are spread over these by character/object, each is its own connection
+		asyncWriters = std::max(globalDBConf->getInt("AsyncWriters",1),1);
+		//queued writes committed together, 1 keeps every write its own transaction
+		groupCommitOps = std::max(globalDBConf->getInt("GroupCommitOps",1),1);
+		groupCommitMS = std::max(globalDBConf->getInt("GroupCommitMS",50),0);
+		//query connections, opened up to PoolMax while queries wait PoolGrowWaitMS or more for one
+		poolMin = std::max(globalDBConf->getInt("PoolMin",1),1);
+		poolMax = std::max(globalDBConf->getInt("PoolMax",4),1);
+		poolGrowWaitMS = std::max(globalDBConf->getInt("PoolGrowWaitMS",10),0);
+		//idle connections get a SELECT 1 this often, 0 disables
+		poolHealthCheckSec = std::max(globalDBConf->getInt("PoolHealthCheckSec",30),0);
 	}
 
-	if (!_charDb->initialise(dbLogger,initString))
+	Poco::AutoPtr<Poco::Util::AbstractConfiguration> objConf(config().createView("Objects"));
+	//parallel object load wants a pool connection per query
+	size_t objConns = objConf->getBool("ParallelLoad",true) ? 2 : 1;
+
+	_charDb->setAsyncWriters(asyncWriters);
+	_charDb->setPoolPolicy(poolMin,poolMax,poolGrowWaitMS,poolHealthCheckSec);
+	if (!_charDb->initialise(dbLogger,initString,false,"",objConns))
 		return false;
 
 	_charDb->allowAsyncOperations();
+	_charDb->setDelayPolicy(asyncMinBatch,asyncMaxLingerMS);
+	_charDb->setGroupCommit(groupCommitOps,groupCommitMS);
 	_objDb = _charDb;
 	_custDb = _charDb;
 	
 	//pass the db along to character datasource
 	{
-		static const string defaultID = "PlayerUID";
-		static const string defaultWS = "Worldspace";
-
 		Poco::AutoPtr<Poco::Util::AbstractConfiguration> charDBConf(config().createView("Characters"));
-		_charData.reset(new SqlCharDataSource(logger(),_charDb,charDBConf->getString("IDField",defaultID),charDBConf->getString("WSField",defaultWS)));	
+		_charData.reset(new SqlCharDataSource(logger(),_charDb,charDBConf.get()));	
 	}
 
+	string objInitString = initString;
 	Poco::AutoPtr<Poco::Util::AbstractConfiguration> objDBConf(config().createView("ObjectDB"));
 	bool useExternalObjDb = objDBConf->getBool("Use",false);
 	if (useExternalObjDb)
@@ -67,10 +93,15 @@ bool DirectHiveApp::initialiseService()
 		
 		Poco::Logger& objDBLogger = Poco::Logger::get("ObjectDB");
 
-		if (!_objDb->initialise(objDBLogger,DatabaseLoader::makeInitString(objDBConf)))
+		objInitString = DatabaseLoader::makeInitString(objDBConf);
+		_objDb->setAsyncWriters(asyncWriters);
+		_objDb->setPoolPolicy(poolMin,poolMax,poolGrowWaitMS,poolHealthCheckSec);
+		if (!_objDb->initialise(objDBLogger,objInitString,false,"",objConns))
 			return false;
 
 		_objDb->allowAsyncOperations();
+		_objDb->setDelayPolicy(asyncMinBatch,asyncMaxLingerMS);
+		_objDb->setGroupCommit(groupCommitOps,groupCommitMS);
 	}
 
 	Poco::AutoPtr<Poco::Util::AbstractConfiguration> custDBConf(config().createView("CustomDB"));
@@ -89,9 +120,32 @@ bool DirectHiveApp::initialiseService()
 		_custDb->allowAsyncOperations();
 	}
 	
-	Poco::AutoPtr<Poco::Util::AbstractConfiguration> objConf(config().createView("Objects"));
+	//background cleanup gets its own connections, so its deletes never queue behind game requests
+	shared_ptr<Database> cleanupDb;
+	if (objConf->getBool("Cleanup",false))
+	{
+		Poco::Logger& cleanupLogger = Poco::Logger::get("Cleanup");
+		try
+		{
+			if (useExternalObjDb)
+				cleanupDb = DatabaseLoader::create(objDBConf);
+			else
+				cleanupDb = DatabaseLoader::create(DatabaseLoader::DBTYPE_MYSQL);
+		}
+		catch (const DatabaseLoader::CreationError&)
+		{
+			cleanupLogger.warning("Object cleanup disabled, couldn't create database");
+			cleanupDb.reset();
+		}
+
+		if (cleanupDb && !cleanupDb->initialise(cleanupLogger,objInitString))
+		{
+			cleanupLogger.warning("Object cleanup disabled, couldn't connect to database");
+			cleanupDb.reset();
+		}
+	}
 	//Poco::AutoPtr<Poco::Util::AbstractConfiguration> custConf(config().createView("Custom"));
-	_objData.reset(new SqlObjDataSource(dbLogger,_objDb,objConf.get()));
+	_objData.reset(new SqlObjDataSource(dbLogger,_objDb,objConf.get(),cleanupDb));
 	//_custData.reset(new SqlCustDataSource(_logger,_custDb,custConf.get()));
 	_custData.reset(new SqlCustDataSource(dbLogger,_custDb));
 	
@@ -32,6 +32,8 @@ public:
 	virtual bool initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack ) = 0;
 	virtual bool killCharacter( int characterId, int duration ) = 0;
 	virtual bool recordLogEntry( string playerId, int characterId, int serverId, int action ) = 0;
+	//rereads the instance defaults used for new characters
+	virtual bool reloadInstanceDefaults( int serverId ) = 0;
 protected:
 	static int SanitiseInv(Sqf::Parameters& origInv);
 };
@@ -0,0 +1,88 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "CharacterCache.h"
+
+#include <algorithm>
+
+CharacterCache::Entry::Entry() : hasDetails(false), humanity(2500)
+{
+	for (int i=0;i<4;i++)
+		stats[i] = 0;
+}
+
+CharacterCache::CharacterCache( size_t capacity ) : _capacity(std::max(capacity,size_t(1))), _hits(0), _misses(0) {}
+
+CharacterCache::Entry* CharacterCache::find( int characterId )
+{
+	auto it = _entries.find(characterId);
+	if (it == _entries.end())
+	{
+		_misses++;
+		return nullptr;
+	}
+
+	if (it->second.first.hasDetails)
+		_hits++;
+	else
+		_misses++;
+
+	_usage.splice(_usage.begin(),_usage,it->second.second);
+	return &it->second.first;
+}
+
+CharacterCache::Entry* CharacterCache::peek( int characterId )
+{
+	auto it = _entries.find(characterId);
+	if (it == _entries.end())
+		return nullptr;
+
+	return &it->second.first;
+}
+
+CharacterCache::Entry& CharacterCache::insert( int characterId )
+{
+	auto it = _entries.find(characterId);
+	if (it != _entries.end())
+	{
+		_usage.splice(_usage.begin(),_usage,it->second.second);
+		return it->second.first;
+	}
+
+	if (_entries.size() >= _capacity)
+	{
+		_entries.erase(_usage.back());
+		_usage.pop_back();
+	}
+
+	_usage.push_front(characterId);
+	auto& slot = _entries[characterId];
+	slot.second = _usage.begin();
+	return slot.first;
+}
+
+bool CharacterCache::remove( int characterId )
+{
+	auto it = _entries.find(characterId);
+	if (it == _entries.end())
+		return false;
+
+	_usage.erase(it->second.second);
+	_entries.erase(it);
+	return true;
+}
@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "../Sqf.h"
+#include <list>
+
+//least recently used cache of live characters, keyed by characterId
+//entries are filled by login and detail loads and kept current by the updates written through the datasource
+class CharacterCache
+{
+public:
+	struct Entry
+	{
+		Entry();
+
+		//detail fields are only valid once a detail load has filled them
+		bool hasDetails;
+
+		Sqf::Value worldSpace;
+		Sqf::Value inventory;
+		Sqf::Value backpack;
+		string model;
+
+		Sqf::Value medical;
+		Sqf::Value state;
+		int stats[4]; //killsZ, headZ, killsH, killsB
+		int humanity;
+	};
+
+	explicit CharacterCache(size_t capacity);
+
+	size_t size() const { return _entries.size(); }
+	size_t capacity() const { return _capacity; }
+
+	//marks the entry as most recently used, entries without details count as misses
+	Entry* find(int characterId);
+	//for updates, doesn't touch the counters or the usage order
+	Entry* peek(int characterId);
+	//returns the existing entry or a fresh one, evicting the least recently used if full
+	Entry& insert(int characterId);
+	bool remove(int characterId);
+
+	UInt64 hits() const { return _hits; }
+	UInt64 misses() const { return _misses; }
+private:
+	typedef std::list<int> UsageList;
+	typedef unordered_map< int,std::pair<Entry,UsageList::iterator> > EntryMap;
+
+	size_t _capacity;
+	EntryMap _entries;
+	UsageList _usage; //front is the most recently used
+
+	UInt64 _hits;
+	UInt64 _misses;
+};
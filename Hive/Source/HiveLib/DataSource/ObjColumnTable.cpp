@@ -0,0 +1,295 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "ObjColumnTable.h"
+
+#include <functional>
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace
+{
+	const UInt32 UNKNOWN_CLASS_ID = 0xFFFFFFFF;
+
+	//branch-free body, so the compiler is free to vectorize it
+	template<typename T, typename Pred>
+	void MaskKernel(const T* col, size_t count, T value, UInt8* mask, Pred pred)
+	{
+		for (size_t i=0; i<count; i++)
+			mask[i] &= static_cast<UInt8>(pred(col[i],value));
+	}
+
+	template<typename T>
+	void ApplyFilter(const vector<T>& col, ObjColumnTable::CompareOp op, T value, UInt8* mask)
+	{
+		if (col.empty())
+			return;
+
+		const T* data = &col[0];
+		size_t count = col.size();
+		switch (op)
+		{
+		case ObjColumnTable::OP_EQ: MaskKernel(data,count,value,mask,std::equal_to<T>()); break;
+		case ObjColumnTable::OP_NE: MaskKernel(data,count,value,mask,std::not_equal_to<T>()); break;
+		case ObjColumnTable::OP_LT: MaskKernel(data,count,value,mask,std::less<T>()); break;
+		case ObjColumnTable::OP_LE: MaskKernel(data,count,value,mask,std::less_equal<T>()); break;
+		case ObjColumnTable::OP_GT: MaskKernel(data,count,value,mask,std::greater<T>()); break;
+		case ObjColumnTable::OP_GE: MaskKernel(data,count,value,mask,std::greater_equal<T>()); break;
+		}
+	}
+};
+
+bool ObjColumnTable::ParseColumn( const string& name, Column& out )
+{
+	if (boost::iequals(name,"class"))			out = COL_CLASS;
+	else if (boost::iequals(name,"owner"))		out = COL_OWNER;
+	else if (boost::iequals(name,"x"))			out = COL_X;
+	else if (boost::iequals(name,"y"))			out = COL_Y;
+	else if (boost::iequals(name,"z"))			out = COL_Z;
+	else if (boost::iequals(name,"damage"))		out = COL_DAMAGE;
+	else if (boost::iequals(name,"fuel"))		out = COL_FUEL;
+	else if (boost::iequals(name,"created"))	out = COL_CREATED;
+	else if (boost::iequals(name,"deployable"))	out = COL_DEPLOYABLE;
+	else
+		return false;
+
+	return true;
+}
+
+bool ObjColumnTable::ParseOp( const string& name, CompareOp& out )
+{
+	if (name == "=" || name == "==")	out = OP_EQ;
+	else if (name == "!=")				out = OP_NE;
+	else if (name == "<")				out = OP_LT;
+	else if (name == "<=")				out = OP_LE;
+	else if (name == ">")				out = OP_GT;
+	else if (name == ">=")				out = OP_GE;
+	else
+		return false;
+
+	return true;
+}
+
+void ObjColumnTable::clear()
+{
+	_ident.clear();
+	_deployable.clear();
+	_classId.clear();
+	_owner.clear();
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_damage.clear();
+	_fuel.clear();
+	_created.clear();
+	_rowOf.clear();
+	//class dictionary survives reloads, ids stay stable
+}
+
+bool ObjColumnTable::findRow( Int64 ident, bool byUID, UInt32& row ) const
+{
+	auto it = _rowOf.find(ObjKey(ident,byUID));
+	if (it == _rowOf.end())
+		return false;
+
+	row = it->second;
+	return true;
+}
+
+UInt32 ObjColumnTable::internClass( const string& className )
+{
+	auto it = _classIds.find(className);
+	if (it != _classIds.end())
+		return it->second;
+
+	UInt32 newId = static_cast<UInt32>(_classNames.size());
+	_classNames.push_back(className);
+	_classIds.insert(std::make_pair(className,newId));
+	return newId;
+}
+
+UInt32 ObjColumnTable::classIdFor( const string& className ) const
+{
+	auto it = _classIds.find(className);
+	if (it == _classIds.end())
+		return UNKNOWN_CLASS_ID;
+
+	return it->second;
+}
+
+void ObjColumnTable::upsert( Int64 ident, bool byUID, const string& className, Int32 owner,
+	double x, double y, double z, double damage, double fuel, Int32 created )
+{
+	UInt32 row;
+	if (!findRow(ident,byUID,row))
+	{
+		row = static_cast<UInt32>(_ident.size());
+		_rowOf.insert(std::make_pair(ObjKey(ident,byUID),row));
+
+		_ident.push_back(ident);
+		_deployable.push_back(byUID ? 1 : 0);
+		_classId.push_back(0);
+		_owner.push_back(0);
+		_x.push_back(0);
+		_y.push_back(0);
+		_z.push_back(0);
+		_damage.push_back(0);
+		_fuel.push_back(0);
+		_created.push_back(0);
+	}
+
+	_classId[row] = internClass(className);
+	_owner[row] = owner;
+	_x[row] = static_cast<float>(x);
+	_y[row] = static_cast<float>(y);
+	_z[row] = static_cast<float>(z);
+	_damage[row] = static_cast<float>(damage);
+	_fuel[row] = static_cast<float>(fuel);
+	_created[row] = created;
+}
+
+bool ObjColumnTable::setPosition( Int64 ident, bool byUID, double x, double y, double z )
+{
+	UInt32 row;
+	if (!findRow(ident,byUID,row))
+		return false;
+
+	_x[row] = static_cast<float>(x);
+	_y[row] = static_cast<float>(y);
+	_z[row] = static_cast<float>(z);
+	return true;
+}
+
+bool ObjColumnTable::setFuel( Int64 ident, bool byUID, double fuel )
+{
+	UInt32 row;
+	if (!findRow(ident,byUID,row))
+		return false;
+
+	_fuel[row] = static_cast<float>(fuel);
+	return true;
+}
+
+bool ObjColumnTable::setDamage( Int64 ident, bool byUID, double damage )
+{
+	UInt32 row;
+	if (!findRow(ident,byUID,row))
+		return false;
+
+	_damage[row] = static_cast<float>(damage);
+	return true;
+}
+
+bool ObjColumnTable::remove( Int64 ident, bool byUID )
+{
+	UInt32 row;
+	if (!findRow(ident,byUID,row))
+		return false;
+
+	_rowOf.erase(ObjKey(ident,byUID));
+
+	UInt32 last = static_cast<UInt32>(_ident.size()-1);
+	if (row != last)
+	{
+		_ident[row] = _ident[last];
+		_deployable[row] = _deployable[last];
+		_classId[row] = _classId[last];
+		_owner[row] = _owner[last];
+		_x[row] = _x[last];
+		_y[row] = _y[last];
+		_z[row] = _z[last];
+		_damage[row] = _damage[last];
+		_fuel[row] = _fuel[last];
+		_created[row] = _created[last];
+		_rowOf[ObjKey(_ident[row],_deployable[row] != 0)] = row;
+	}
+
+	_ident.pop_back();
+	_deployable.pop_back();
+	_classId.pop_back();
+	_owner.pop_back();
+	_x.pop_back();
+	_y.pop_back();
+	_z.pop_back();
+	_damage.pop_back();
+	_fuel.pop_back();
+	_created.pop_back();
+	return true;
+}
+
+void ObjColumnTable::select( const FilterList& filters, RowList& out ) const
+{
+	size_t count = _ident.size();
+	if (count < 1)
+		return;
+
+	vector<UInt8> mask(count,1);
+	UInt8* maskPtr = &mask[0];
+	for (auto it=filters.begin(); it!=filters.end(); ++it)
+	{
+		const Filter& filt = *it;
+		switch (filt.column)
+		{
+		case COL_CLASS:			ApplyFilter(_classId,filt.op,static_cast<UInt32>(filt.value),maskPtr); break;
+		case COL_OWNER:			ApplyFilter(_owner,filt.op,static_cast<Int32>(filt.value),maskPtr); break;
+		case COL_X:				ApplyFilter(_x,filt.op,static_cast<float>(filt.value),maskPtr); break;
+		case COL_Y:				ApplyFilter(_y,filt.op,static_cast<float>(filt.value),maskPtr); break;
+		case COL_Z:				ApplyFilter(_z,filt.op,static_cast<float>(filt.value),maskPtr); break;
+		case COL_DAMAGE:		ApplyFilter(_damage,filt.op,static_cast<float>(filt.value),maskPtr); break;
+		case COL_FUEL:			ApplyFilter(_fuel,filt.op,static_cast<float>(filt.value),maskPtr); break;
+		case COL_CREATED:		ApplyFilter(_created,filt.op,static_cast<Int32>(filt.value),maskPtr); break;
+		case COL_DEPLOYABLE:	ApplyFilter(_deployable,filt.op,static_cast<UInt8>(filt.value != 0),maskPtr); break;
+		}
+	}
+
+	for (size_t i=0; i<count; i++)
+	{
+		if (mask[i])
+			out.push_back(static_cast<UInt32>(i));
+	}
+}
+
+bool ObjColumnTable::countBy( Column groupBy, const RowList& rows, GroupCounts& out ) const
+{
+	if (groupBy == COL_CLASS)
+	{
+		//dictionary ids are dense, so a flat histogram does
+		vector<UInt32> hist(_classNames.size(),0);
+		for (auto it=rows.begin(); it!=rows.end(); ++it)
+			hist[_classId[*it]]++;
+
+		for (size_t i=0; i<hist.size(); i++)
+		{
+			if (hist[i] > 0)
+				out.push_back(std::make_pair(static_cast<Int64>(i),hist[i]));
+		}
+		return true;
+	}
+	else if (groupBy == COL_OWNER || groupBy == COL_DEPLOYABLE)
+	{
+		map<Int64,UInt32> counts;
+		for (auto it=rows.begin(); it!=rows.end(); ++it)
+		{
+			Int64 key = (groupBy == COL_OWNER) ? _owner[*it] : _deployable[*it];
+			counts[key]++;
+		}
+		out.insert(out.end(),counts.begin(),counts.end());
+		return true;
+	}
+
+	return false;
+}
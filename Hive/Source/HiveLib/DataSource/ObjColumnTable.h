@@ -0,0 +1,106 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+//struct-of-arrays copy of the loaded world objects, for scans that shouldn't hit the database
+//rows are unordered, removal moves the last row into the hole
+class ObjColumnTable
+{
+public:
+	enum Column
+	{
+		COL_CLASS,
+		COL_OWNER,
+		COL_X,
+		COL_Y,
+		COL_Z,
+		COL_DAMAGE,
+		COL_FUEL,
+		COL_CREATED,
+		COL_DEPLOYABLE
+	};
+	enum CompareOp
+	{
+		OP_EQ,
+		OP_NE,
+		OP_LT,
+		OP_LE,
+		OP_GT,
+		OP_GE
+	};
+	struct Filter
+	{
+		Column column;
+		CompareOp op;
+		double value;
+	};
+	typedef vector<Filter> FilterList;
+	typedef vector<UInt32> RowList;
+	typedef vector< std::pair<Int64,UInt32> > GroupCounts;
+
+	static bool ParseColumn(const string& name, Column& out);
+	static bool ParseOp(const string& name, CompareOp& out);
+
+	void clear();
+	size_t size() const { return _ident.size(); }
+
+	//inserts, or overwrites if already present
+	void upsert(Int64 ident, bool byUID, const string& className, Int32 owner,
+		double x, double y, double z, double damage, double fuel, Int32 created);
+	bool setPosition(Int64 ident, bool byUID, double x, double y, double z);
+	bool setFuel(Int64 ident, bool byUID, double fuel);
+	bool setDamage(Int64 ident, bool byUID, double damage);
+	bool remove(Int64 ident, bool byUID);
+
+	//class filters compare against dictionary ids, unknown names get an id no row has
+	UInt32 classIdFor(const string& className) const;
+	const string& className(UInt32 classId) const { return _classNames[classId]; }
+
+	//rows satisfying every filter
+	void select(const FilterList& filters, RowList& out) const;
+	//number of rows per distinct value of the class, owner or deployable column
+	bool countBy(Column groupBy, const RowList& rows, GroupCounts& out) const;
+
+	Int64 ident(UInt32 row) const { return _ident[row]; }
+	bool isDeployable(UInt32 row) const { return _deployable[row] != 0; }
+	UInt32 classId(UInt32 row) const { return _classId[row]; }
+private:
+	typedef std::pair<Int64,bool> ObjKey;
+	bool findRow(Int64 ident, bool byUID, UInt32& row) const;
+	UInt32 internClass(const string& className);
+
+	//columns
+	vector<Int64> _ident;
+	vector<UInt8> _deployable;
+	vector<UInt32> _classId;
+	vector<Int32> _owner;
+	vector<float> _x;
+	vector<float> _y;
+	vector<float> _z;
+	vector<float> _damage;
+	vector<float> _fuel;
+	vector<Int32> _created;
+
+	unordered_map<ObjKey,UInt32> _rowOf;
+
+	vector<string> _classNames;
+	unordered_map<string,UInt32> _classIds;
+};
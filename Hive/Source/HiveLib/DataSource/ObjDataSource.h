@@ -27,6 +27,8 @@ public:
 
 	typedef std::queue<Sqf::Parameters> ServerObjectsQueue;
 	virtual void populateObjects( int serverId, ServerObjectsQueue& queue ) = 0;
+	//objects changed or deleted at or after sinceCursor, newCursor is what to pass next time
+	virtual bool populateChangedObjects( int serverId, Int64 sinceCursor, Int64& newCursor, ServerObjectsQueue& queue ) = 0;
 
 	virtual bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory ) = 0;
 	virtual bool deleteObject( int serverId, Int64 objectIdent, bool byUID ) = 0;
@@ -35,4 +37,10 @@ public:
 	//virtual bool createObject( int serverId, const string& className, string characterId, const Sqf::Value& worldSpace, Int64 uniqueId ) = 0;
 	virtual bool createObject( int serverId, const string& className, double damage, int characterId, 
 		const Sqf::Value& worldSpace, const Sqf::Value& inventory, const Sqf::Value& hitPoints, double fuel, Int64 uniqueId, int combinationId ) = 0;
+
+	//positional lookups over the objects loaded by populateObjects
+	virtual void objectsInRadius( int serverId, double x, double y, double radius, ServerObjectsQueue& queue ) = 0;
+	virtual void objectsInBox( int serverId, double x1, double y1, double x2, double y2, ServerObjectsQueue& queue ) = 0;
+	//filter/aggregate over the in-memory object table, false if it's disabled or the filters are bad
+	virtual bool queryObjectTable( int serverId, const Sqf::Parameters& filters, const string& groupBy, ServerObjectsQueue& queue ) = 0;
 };
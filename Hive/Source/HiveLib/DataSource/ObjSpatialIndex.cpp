@@ -0,0 +1,177 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "ObjSpatialIndex.h"
+
+#include <cmath>
+#include <algorithm>
+
+ObjSpatialIndex::ObjSpatialIndex( double cellSize ) : _cellSize(cellSize)
+{
+	if (_cellSize <= 0)
+		_cellSize = 100.0;
+}
+
+void ObjSpatialIndex::clear()
+{
+	_entries.clear();
+	_cells.clear();
+}
+
+Int32 ObjSpatialIndex::cellCoord( double v ) const
+{
+	return static_cast<Int32>(std::floor(v / _cellSize));
+}
+
+ObjSpatialIndex::CellKey ObjSpatialIndex::makeCellKey( Int32 cx, Int32 cy )
+{
+	return (static_cast<Int64>(cx) << 32) | static_cast<UInt32>(cy);
+}
+
+void ObjSpatialIndex::unlinkFromCell( CellKey cell, const ObjKey& key )
+{
+	auto cellIt = _cells.find(cell);
+	if (cellIt == _cells.end())
+		return;
+
+	vector<ObjKey>& keys = cellIt->second;
+	auto it = std::find(keys.begin(),keys.end(),key);
+	if (it != keys.end())
+	{
+		//order within a cell doesn't matter
+		*it = keys.back();
+		keys.pop_back();
+	}
+	if (keys.empty())
+		_cells.erase(cellIt);
+}
+
+void ObjSpatialIndex::insert( Int64 ident, bool byUID, const string& className, double x, double y )
+{
+	ObjKey key(ident,byUID);
+	auto it = _entries.find(key);
+	if (it != _entries.end())
+	{
+		it->second.className = className;
+		move(ident,byUID,x,y);
+		return;
+	}
+
+	Entry newEntry;
+	newEntry.ident = ident;
+	newEntry.byUID = byUID;
+	newEntry.className = className;
+	newEntry.x = x;
+	newEntry.y = y;
+	_entries.insert(std::make_pair(key,newEntry));
+	_cells[cellFor(x,y)].push_back(key);
+}
+
+bool ObjSpatialIndex::move( Int64 ident, bool byUID, double x, double y )
+{
+	ObjKey key(ident,byUID);
+	auto it = _entries.find(key);
+	if (it == _entries.end())
+		return false;
+
+	Entry& entry = it->second;
+	CellKey oldCell = cellFor(entry.x,entry.y);
+	CellKey newCell = cellFor(x,y);
+	entry.x = x;
+	entry.y = y;
+
+	if (oldCell != newCell)
+	{
+		unlinkFromCell(oldCell,key);
+		_cells[newCell].push_back(key);
+	}
+	return true;
+}
+
+bool ObjSpatialIndex::remove( Int64 ident, bool byUID )
+{
+	ObjKey key(ident,byUID);
+	auto it = _entries.find(key);
+	if (it == _entries.end())
+		return false;
+
+	unlinkFromCell(cellFor(it->second.x,it->second.y),key);
+	_entries.erase(it);
+	return true;
+}
+
+void ObjSpatialIndex::queryBox( double minX, double minY, double maxX, double maxY, ResultsType& out ) const
+{
+	if (minX > maxX) std::swap(minX,maxX);
+	if (minY > maxY) std::swap(minY,maxY);
+
+	Int32 cx0 = cellCoord(minX), cx1 = cellCoord(maxX);
+	Int32 cy0 = cellCoord(minY), cy1 = cellCoord(maxY);
+
+	auto collectCell = [&](const vector<ObjKey>& keys)
+	{
+		for (auto it=keys.begin(); it!=keys.end(); ++it)
+		{
+			const Entry& entry = _entries.find(*it)->second;
+			if (entry.x >= minX && entry.x <= maxX && entry.y >= minY && entry.y <= maxY)
+				out.push_back(&entry);
+		}
+	};
+
+	//a box covering more cells than are occupied is cheaper to answer by walking the occupied ones
+	double spanCells = (static_cast<double>(cx1)-cx0+1) * (static_cast<double>(cy1)-cy0+1);
+	if (spanCells > static_cast<double>(_cells.size()))
+	{
+		for (auto it=_cells.begin(); it!=_cells.end(); ++it)
+		{
+			Int32 cx = static_cast<Int32>(it->first >> 32);
+			Int32 cy = static_cast<Int32>(static_cast<UInt32>(it->first & 0xFFFFFFFF));
+			if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+				collectCell(it->second);
+		}
+		return;
+	}
+
+	for (Int32 cx=cx0; cx<=cx1; cx++)
+	{
+		for (Int32 cy=cy0; cy<=cy1; cy++)
+		{
+			auto cellIt = _cells.find(makeCellKey(cx,cy));
+			if (cellIt != _cells.end())
+				collectCell(cellIt->second);
+		}
+	}
+}
+
+void ObjSpatialIndex::queryRadius( double x, double y, double radius, ResultsType& out ) const
+{
+	if (radius < 0)
+		return;
+
+	ResultsType inBox;
+	queryBox(x-radius,y-radius,x+radius,y+radius,inBox);
+
+	double radiusSq = radius*radius;
+	for (auto it=inBox.begin(); it!=inBox.end(); ++it)
+	{
+		double dx = (*it)->x - x;
+		double dy = (*it)->y - y;
+		if (dx*dx + dy*dy <= radiusSq)
+			out.push_back(*it);
+	}
+}
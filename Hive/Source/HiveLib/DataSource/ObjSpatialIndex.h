@@ -0,0 +1,67 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+//uniform grid over the 2d positions of the loaded world objects
+//objects are keyed by their ident and by whether that ident is a deployable unique_id or a vehicle id
+class ObjSpatialIndex
+{
+public:
+	struct Entry
+	{
+		Int64 ident;
+		bool byUID;
+		string className;
+		double x;
+		double y;
+	};
+	typedef vector<const Entry*> ResultsType;
+
+	explicit ObjSpatialIndex(double cellSize = 100.0);
+
+	void clear();
+	size_t size() const { return _entries.size(); }
+
+	//inserts, or repositions if already present
+	void insert(Int64 ident, bool byUID, const string& className, double x, double y);
+	bool move(Int64 ident, bool byUID, double x, double y);
+	bool remove(Int64 ident, bool byUID);
+
+	//results point into the index and are only valid until it's next modified
+	void queryBox(double minX, double minY, double maxX, double maxY, ResultsType& out) const;
+	void queryRadius(double x, double y, double radius, ResultsType& out) const;
+private:
+	typedef std::pair<Int64,bool> ObjKey;
+	typedef Int64 CellKey;
+
+	Int32 cellCoord(double v) const;
+	static CellKey makeCellKey(Int32 cx, Int32 cy);
+	CellKey cellFor(double x, double y) const { return makeCellKey(cellCoord(x),cellCoord(y)); }
+
+	void unlinkFromCell(CellKey cell, const ObjKey& key);
+
+	double _cellSize;
+
+	typedef unordered_map<ObjKey,Entry> EntryMap;
+	EntryMap _entries;
+	typedef unordered_map< CellKey,vector<ObjKey> > CellMap;
+	CellMap _cells;
+};
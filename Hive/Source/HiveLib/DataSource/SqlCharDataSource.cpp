@@ -18,38 +18,357 @@
 
 #include "SqlCharDataSource.h"
 #include "Database/Database.h"
+#include "Shared/Common/Timer.h"
+#include "../SqfBinary.h"
 
 #include <boost/lexical_cast.hpp>
 using boost::lexical_cast;
 using boost::bad_lexical_cast;
 
-SqlCharDataSource::SqlCharDataSource( Poco::Logger& logger, shared_ptr<Database> db, const string& idFieldName, const string& wsFieldName ) : SqlDataSource(logger,db)
+#include <Poco/Util/AbstractConfiguration.h>
+SqlCharDataSource::SqlCharDataSource( Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf ) : SqlDataSource(logger,db),
+	_logThread("Log Flush"), _logStop(false), _logFlusher(*this,&SqlCharDataSource::runLogFlusher)
 {
-	_idFieldName = getDB()->escape(idFieldName);
-	_wsFieldName = getDB()->escape(wsFieldName);
+	static const string defaultID = "PlayerUID";
+	static const string defaultWS = "Worldspace";
+
+	_idFieldName = getDB()->escape(conf->getString("IDField",defaultID));
+	_wsFieldName = getDB()->escape(conf->getString("WSField",defaultWS));
+	_loginProcedure = conf->getBool("LoginProcedure",false);
+
+	_binaryStorage = conf->getBool("BinaryFormat",false);
+	if (conf->getBool("BinaryMigrate",false))
+	{
+		vector<string> cols;
+		cols.push_back("inventory");
+		cols.push_back("backpack");
+		cols.push_back("medical");
+		convertStoredColumns("survivor", "id", cols, _binaryStorage);
+	}
+	_coalesceMS = std::max(conf->getInt("UpdateCoalesceMS",0),0);
+	_profileCacheSize = std::max(conf->getInt("ProfileCacheSize",10000),0);
+	_profilePreloadDays = conf->getInt("ProfilePreloadDays",0);
+	_instanceRefreshMS = std::max(conf->getInt("InstanceRefreshSec",600),0) * 1000;
+	_logBatchSize = std::max(conf->getInt("LogBatchSize",50),0);
+	_logFlushMS = std::max(conf->getInt("LogFlushMS",5000),0);
+	_logCodesLoaded = false;
+	_logBufferStart = 0;
+	_batchFlush = conf->getBool("BatchFlush",true);
+
+	int cacheSize = conf->getInt("CacheSize",512);
+	if (cacheSize > 0)
+		_charCache.reset(new CharacterCache(cacheSize));
+
+	//done here so no login has to wait on it, players not yet cached just use the profile query
+	preloadProfiles();
+
+	if (_logBatchSize > 1 && _logFlushMS > 0)
+		_logThread.start(_logFlusher);
+}
+
+SqlCharDataSource::~SqlCharDataSource() 
+{
+	flushPending(true);
+
+	_logStop.set();
+	if (_logThread.isRunning())
+		_logThread.join();
+	flushLogEntries(true);
+
+	if (_charCache)
+		logCacheStats();
 }
 
-SqlCharDataSource::~SqlCharDataSource() {}
+void SqlCharDataSource::logCacheStats()
+{
+	UInt64 hits = _charCache->hits();
+	UInt64 total = hits + _charCache->misses();
+	_logger.information("Character cache: " + lexical_cast<string>(hits) + " hits out of " + lexical_cast<string>(total) + " lookups (" +
+		lexical_cast<string>(total > 0 ? (hits * 100 / total) : 0) + "%), " +
+		lexical_cast<string>(_charCache->size()) + "/" + lexical_cast<string>(_charCache->capacity()) + " entries");
+}
+
+void SqlCharDataSource::cacheLogin( const LoginInfo& info )
+{
+	if (!_charCache)
+		return;
+
+	//details are kept across logins, unless what the login read shows the row was changed outside of the hive
+	CharacterCache::Entry& entry = _charCache->insert(info.characterId);
+	if (entry.hasDetails)
+	{
+		if (lexical_cast<string>(entry.worldSpace) != lexical_cast<string>(info.worldSpace) ||
+			lexical_cast<string>(entry.inventory) != lexical_cast<string>(info.inventory) ||
+			lexical_cast<string>(entry.backpack) != lexical_cast<string>(info.backpack) ||
+			entry.model != info.model)
+			entry.hasDetails = false;
+	}
+	entry.worldSpace = info.worldSpace;
+	entry.inventory = info.inventory;
+	entry.backpack = info.backpack;
+	entry.model = info.model;
+}
+
+void SqlCharDataSource::parseLoginFields( QueryResult* res, size_t firstCol, LoginInfo& out ) const
+{
+	int characterId = res->at(firstCol).getInt32();
+	out.characterId = characterId;
+	try
+	{
+		out.worldSpace = lexical_cast<Sqf::Value>(res->at(firstCol+1).getString());
+	}
+	catch(bad_lexical_cast)
+	{
+		_logger.warning("Invalid Worldspace for CharacterID("+lexical_cast<string>(characterId)+"): "+res->at(firstCol+1).getString());
+	}
+	if (!res->at(firstCol+2).isNull()) //inventory can be null
+	{
+		try
+		{
+			out.inventory = Sqf::FromStorage(res->at(firstCol+2).getString());
+			try { SanitiseInv(boost::get<Sqf::Parameters>(out.inventory)); } catch (const boost::bad_get&) {}
+		}
+		catch(bad_lexical_cast)
+		{
+			_logger.warning("Invalid Inventory for CharacterID("+lexical_cast<string>(characterId)+"): "+res->at(firstCol+2).getString());
+		}
+	}		
+	if (!res->at(firstCol+3).isNull()) //backpack can be null
+	{
+		try
+		{
+			out.backpack = Sqf::FromStorage(res->at(firstCol+3).getString());
+		}
+		catch(bad_lexical_cast)
+		{
+			_logger.warning("Invalid Backpack for CharacterID("+lexical_cast<string>(characterId)+"): "+res->at(firstCol+3).getString());
+		}
+	}
+	//set survival info
+	{
+		Sqf::Parameters& survivalArr = boost::get<Sqf::Parameters>(out.survival);
+		survivalArr[0] = res->at(firstCol+4).getInt32();
+		survivalArr[1] = res->at(firstCol+5).getInt32();
+		survivalArr[2] = res->at(firstCol+6).getInt32();
+	}
+	try
+	{
+		out.model = boost::get<string>(lexical_cast<Sqf::Value>(res->at(firstCol+7).getString()));
+	}
+	catch(...)
+	{
+		out.model = res->at(firstCol+7).getString();
+	}
+}
+
+Sqf::Parameters SqlCharDataSource::LoginReturn( bool newPlayer, bool newChar, const LoginInfo& info )
+{
+	//always push back full login details
+	Sqf::Parameters retVal;
+	retVal.push_back(string("PASS"));
+	retVal.push_back(newPlayer);
+	retVal.push_back(lexical_cast<string>(info.characterId));
+	if (!newChar)
+	{
+	retVal.push_back(info.worldSpace);
+	retVal.push_back(info.inventory);
+	retVal.push_back(info.backpack);
+	retVal.push_back(info.survival);
+	}
+	retVal.push_back(info.model);
+	//hive interface version
+	retVal.push_back(0.96f);
+
+	return retVal;
+}
+
+bool SqlCharDataSource::fetchCharacterInitialProc( const string& playerId, int serverId, const string& playerName, Sqf::Parameters& retVal )
+{
+	//profile check, rename/insert, character lookup and last login or creation, all in one round trip
+	auto loginRes = getDB()->queryParams("call `pCharacterLogin`('%s', '%s', %d)", 
+		getDB()->escape(playerId).c_str(), getDB()->escape(playerName).c_str(), serverId);
+	if (!loginRes || !loginRes->fetchRow())
+		return false;
+
+	bool newPlayer = loginRes->at(0).getBool();
+	bool newChar = loginRes->at(1).getBool();
+	if (loginRes->at(2).isNull())
+	{
+		_logger.error("Error creating character for playerId " + playerId);
+		retVal.push_back(string("ERROR"));
+		return true;
+	}
+
+	LoginInfo info;
+	info.worldSpace = Sqf::Parameters();
+	info.inventory = lexical_cast<Sqf::Value>("[]");
+	info.backpack = lexical_cast<Sqf::Value>("[]");
+	info.survival = lexical_cast<Sqf::Value>("[0,0,0]");
+	parseLoginFields(loginRes.get(), 2, info);
+
+	if (newPlayer)
+		_logger.information("Created a new player " + playerId + " named '" + playerName + "'");
+	else if (loginRes->at(11).getString() != playerName)
+		_logger.information("Changed name of player " + playerId + " from '" + loginRes->at(11).getString() + "' to '" + playerName + "'");
+	if (newChar)
+		_logger.information("Created a new character " + lexical_cast<string>(info.characterId) + " for player '" + playerName + "' (" + playerId + ")" );
+
+	cacheProfile(playerId, playerName);
+	cacheLogin(info);
+	retVal = LoginReturn(newPlayer, newChar, info);
+	return true;
+}
+
+void SqlCharDataSource::cacheProfile( const string& playerId, const string& playerName )
+{
+	auto it = _profileNames.find(playerId);
+	if (it != _profileNames.end())
+		it->second = playerName;
+	else if (_profileNames.size() < _profileCacheSize)
+		_profileNames[playerId] = playerName;
+}
+
+void SqlCharDataSource::preloadProfiles()
+{
+	if (_profilePreloadDays <= 0 || _profileCacheSize == 0)
+		return;
+
+	//players that have been on recently are the ones most likely to reconnect
+	auto profRes = getDB()->queryParams("select distinct p.`unique_id`, p.`name` from `profile` p join `survivor` s on s.`unique_id` = p.`unique_id` "
+		"where s.`last_updated` >= now() - interval %d day limit %d", _profilePreloadDays, static_cast<int>(_profileCacheSize));
+	while (profRes && profRes->fetchRow())
+		cacheProfile(profRes->at(0).getString(), profRes->at(1).getString());
+
+	_logger.information("Preloaded " + lexical_cast<string>(_profileNames.size()) + " player profiles");
+}
+
+const SqlCharDataSource::InstanceDefaults* SqlCharDataSource::instanceDefaults( int serverId )
+{
+	auto it = _instanceDefaults.find(serverId);
+	bool stale = (it == _instanceDefaults.end());
+	if (!stale && _instanceRefreshMS > 0)
+		stale = (GlobalTimer::getMSTimeDiff(it->second.loadedAt,GlobalTimer::getMSTime()) >= _instanceRefreshMS);
+
+	if (stale)
+	{
+		reloadInstanceDefaults(serverId);
+		it = _instanceDefaults.find(serverId);
+	}
+
+	if (it == _instanceDefaults.end())
+		return nullptr;
+
+	return &it->second;
+}
+
+bool SqlCharDataSource::reloadInstanceDefaults( int serverId )
+{
+	auto instRes = getDB()->queryParams("select `world_id`, `inventory`, `backpack` from `instance` where `id` = %d", serverId);
+	if (!instRes || !instRes->fetchRow())
+	{
+		//keep using what we had if the instance row just couldn't be read
+		if (!instRes)
+			return false;
+
+		_instanceDefaults.erase(serverId);
+		return false;
+	}
+
+	InstanceDefaults defs;
+	defs.worldId = instRes->at(0).getInt32();
+	defs.inventory = lexical_cast<Sqf::Value>("[]");
+	defs.backpack = lexical_cast<Sqf::Value>("[]");
+	if (!instRes->at(1).isNull())
+	{
+		try
+		{
+			defs.inventory = Sqf::FromStorage(instRes->at(1).getString());
+		}
+		catch(bad_lexical_cast)
+		{
+			_logger.warning("Invalid Inventory for Instance("+lexical_cast<string>(serverId)+"): "+instRes->at(1).getString());
+		}
+	}
+	if (!instRes->at(2).isNull())
+	{
+		try
+		{
+			defs.backpack = Sqf::FromStorage(instRes->at(2).getString());
+		}
+		catch(bad_lexical_cast)
+		{
+			_logger.warning("Invalid Backpack for Instance("+lexical_cast<string>(serverId)+"): "+instRes->at(2).getString());
+		}
+	}
+	//stored as written back out, so the insert binds exactly what the login returns
+	defs.inventoryStored = Sqf::ToStorage(defs.inventory, _binaryStorage);
+	defs.backpackStored = Sqf::ToStorage(defs.backpack, _binaryStorage);
+	defs.loadedAt = GlobalTimer::getMSTime();
+
+	_instanceDefaults[serverId] = defs;
+	return true;
+}
 
 Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int serverId, const string& playerName )
 {
+	flushPending(false);
+
+	if (_loginProcedure)
+	{
+		Sqf::Parameters retVal;
+		if (fetchCharacterInitialProc(playerId, serverId, playerName, retVal))
+			return retVal;
+
+		//errors aren't passed up from the query, so check for the procedure itself,
+		//a lost connection or timeout only falls back for this one login
+		auto procRes = getDB()->query("select 1 from information_schema.`routines` where `routine_schema` = database() and `routine_name` = 'pCharacterLogin'");
+		if (procRes && !procRes->fetchRow())
+		{
+			_logger.warning("Login procedure pCharacterLogin doesn't exist, using individual queries from now on");
+			_loginProcedure = false;
+		}
+		else
+			_logger.warning("Login procedure pCharacterLogin failed, using individual queries for " + playerId);
+	}
+
 	bool newPlayer = false;
 	//make sure player exists in db
 	{
-		auto playerRes(getDB()->queryParams("SELECT `name` from `profile` WHERE `unique_id` = '%s'", getDB()->escape(playerId).c_str()));
-		if (playerRes && playerRes->fetchRow())
+		string currName;
+		bool found = false;
+		auto cachedIt = _profileNames.find(playerId);
+		if (cachedIt != _profileNames.end())
+		{
+			currName = cachedIt->second;
+			found = true;
+		}
+		else
+		{
+			auto stmt = getDB()->makeStatement(_stmtFetchPlayerName, "select `name` from `profile` where `unique_id` = ?");
+			stmt->addString(playerId);
+			auto playerRes = stmt->query();
+			if (playerRes && playerRes->fetchRow())
+			{
+				currName = playerRes->at(0).getString();
+				found = true;
+			}
+		}
+
+		if (found)
 		{
 			newPlayer = false;
 			//update player name if not current
-			if (playerRes->at(0).getString() != playerName)
+			if (currName != playerName)
 			{
 				auto stmt = getDB()->makeStatement(_stmtChangePlayerName, "update `profile` set `name` = ? where `unique_id` = ?");
 				stmt->addString(playerName);
 				stmt->addString(playerId);
-				bool exRes = stmt->execute();
+				//profile writes aren't keyed by a character, run them before any of the character's keyed writes can join on profile
+				bool exRes = stmt->directExecute();
 				poco_assert(exRes == true);
-				_logger.information("Changed name of player " + playerId + " from '" + playerRes->at(0).getString() + "' to '" + playerName + "'");
+				_logger.information("Changed name of player " + playerId + " from '" + currName + "' to '" + playerName + "'");
 			}
+			cacheProfile(playerId, playerName);
 		}
 		else
 		{
@@ -58,83 +377,60 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 			auto stmt = getDB()->makeStatement(_stmtInsertPlayer, "insert into profile (`unique_id`, `name`) values (?, ?)");
 			stmt->addString(playerId);
 			stmt->addString(playerName);
-			bool exRes = stmt->execute();
+			//sync, a humanity change or death on the character's writer would otherwise miss the row
+			bool exRes = stmt->directExecute();
 			poco_assert(exRes == true);
 			_logger.information("Created a new player " + playerId + " named '" + playerName + "'");
+			cacheProfile(playerId, playerName);
 		}
 	}
 
+	const InstanceDefaults* defs = instanceDefaults(serverId);
+	if (!defs)
+	{
+		_logger.error("Error creating character for playerId " + playerId + ", no instance " + lexical_cast<string>(serverId));
+		Sqf::Parameters retVal;
+		retVal.push_back(string("ERROR"));
+		return retVal;
+	}
+
 	//get characters from db
-	auto charsRes = getDB()->queryParams(
-		"select s.`id`, s.`worldspace`, s.`inventory`, s.`backpack`, "
-		"timestampdiff(minute, s.`start_time`, s.`last_updated`) as `SurvivalTime`, "
-		"timestampdiff(minute, s.`last_ate`, NOW()) as `MinsLastAte`, "
-		"timestampdiff(minute, s.`last_drank`, NOW()) as `MinsLastDrank`, "
-		"s.`model` from `survivor` s join `instance` i on s.`world_id` = i.`world_id` and i.`id` = %d where s.`unique_id` = '%s' and s.`is_dead` = 0", serverId, getDB()->escape(playerId).c_str());
+	unique_ptr<QueryResult> charsRes;
+	{
+		auto stmt = getDB()->makeStatement(_stmtFetchLoginCharacter,
+			"select s.`id`, s.`worldspace`, s.`inventory`, s.`backpack`, "
+			"timestampdiff(minute, s.`start_time`, s.`last_updated`) as `SurvivalTime`, "
+			"timestampdiff(minute, s.`last_ate`, NOW()) as `MinsLastAte`, "
+			"timestampdiff(minute, s.`last_drank`, NOW()) as `MinsLastDrank`, "
+			"s.`model` from `survivor` s where s.`world_id` = ? and s.`unique_id` = ? and s.`is_dead` = 0");
+		stmt->addInt32(defs->worldId);
+		stmt->addString(playerId);
+		charsRes = stmt->query();
+	}
 
 	bool newChar = false; //not a new char
-	int characterId = -1; //invalid charid
-	Sqf::Value worldSpace = Sqf::Parameters(); //empty worldspace
-	Sqf::Value inventory = lexical_cast<Sqf::Value>("[]"); //empty inventory
-	Sqf::Value backpack = lexical_cast<Sqf::Value>("[]"); //empty backpack
-	Sqf::Value survival = lexical_cast<Sqf::Value>("[0,0,0]"); //0 mins alive, 0 mins since last ate, 0 mins since last drank
-	string model = ""; //empty models will be defaulted by scripts
+	LoginInfo info;
+	int& characterId = info.characterId;
+	Sqf::Value& worldSpace = info.worldSpace;
+	Sqf::Value& inventory = info.inventory;
+	Sqf::Value& backpack = info.backpack;
+	characterId = -1; //invalid charid
+	worldSpace = Sqf::Parameters(); //empty worldspace
+	inventory = lexical_cast<Sqf::Value>("[]"); //empty inventory
+	backpack = lexical_cast<Sqf::Value>("[]"); //empty backpack
+	info.survival = lexical_cast<Sqf::Value>("[0,0,0]"); //0 mins alive, 0 mins since last ate, 0 mins since last drank
+	info.model = ""; //empty models will be defaulted by scripts
 	if (charsRes && charsRes->fetchRow())
 	{
 		newChar = false;
-		characterId = charsRes->at(0).getInt32();
-		try
-		{
-			worldSpace = lexical_cast<Sqf::Value>(charsRes->at(1).getString());
-		}
-		catch(bad_lexical_cast)
-		{
-			_logger.warning("Invalid Worldspace for CharacterID("+lexical_cast<string>(characterId)+"): "+charsRes->at(1).getString());
-		}
-		if (!charsRes->at(2).isNull()) //inventory can be null
-		{
-			try
-			{
-				inventory = lexical_cast<Sqf::Value>(charsRes->at(2).getString());
-				try { SanitiseInv(boost::get<Sqf::Parameters>(inventory)); } catch (const boost::bad_get&) {}
-			}
-			catch(bad_lexical_cast)
-			{
-				_logger.warning("Invalid Inventory for CharacterID("+lexical_cast<string>(characterId)+"): "+charsRes->at(2).getString());
-			}
-		}		
-		if (!charsRes->at(3).isNull()) //backpack can be null
-		{
-			try
-			{
-				backpack = lexical_cast<Sqf::Value>(charsRes->at(3).getString());
-			}
-			catch(bad_lexical_cast)
-			{
-				_logger.warning("Invalid Backpack for CharacterID("+lexical_cast<string>(characterId)+"): "+charsRes->at(3).getString());
-			}
-		}
-		//set survival info
-		{
-			Sqf::Parameters& survivalArr = boost::get<Sqf::Parameters>(survival);
-			survivalArr[0] = charsRes->at(4).getInt32();
-			survivalArr[1] = charsRes->at(5).getInt32();
-			survivalArr[2] = charsRes->at(6).getInt32();
-		}
-		try
-		{
-			model = boost::get<string>(lexical_cast<Sqf::Value>(charsRes->at(7).getString()));
-		}
-		catch(...)
-		{
-			model = charsRes->at(7).getString();
-		}
+		parseLoginFields(charsRes.get(), 0, info);
 
 		//update last login
 		{
 			//update last character login
 			auto stmt = getDB()->makeStatement(_stmtUpdateCharacterLastLogin, "update `survivor` set `last_updated` = CURRENT_TIMESTAMP where `id` = ?");
 			stmt->addInt32(characterId);
+			stmt->setShardKey(characterId);
 			bool exRes = stmt->execute();
 			poco_assert(exRes == true);
 		}
@@ -143,24 +439,21 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 	{
 		newChar = true;
 
-		//try getting custom inventory info
-		{
-			auto invRes = getDB()->queryParams("select `inventory`, `backpack` from `instance` where `id` = %d", serverId);
-			if (invRes && invRes->fetchRow())
-			{
-				inventory = lexical_cast<Sqf::Value>(invRes->at(0).getString());
-				backpack = lexical_cast<Sqf::Value>(invRes->at(1).getString());
-			}
-		}
+		//custom starting gear comes from the instance
+		inventory = defs->inventory;
+		backpack = defs->backpack;
+
 		//insert new char into db
 		{
 			auto stmt = getDB()->makeStatement(_stmtInsertNewCharacter,
 				"insert into `survivor` (`unique_id`, `start_time`, `world_id`, `worldspace`, `inventory`, `backpack`, `medical`) "
-				"select ?, now(), i.`world_id`, ?, i.`inventory`, i.`backpack`, ? from `instance` i where i.`id` = ?");
+				"values (?, now(), ?, ?, ?, ?, ?)");
 			stmt->addString(playerId);
+			stmt->addInt32(defs->worldId);
 			stmt->addString(lexical_cast<string>(worldSpace));
+			AddStored(stmt.get(), defs->inventoryStored);
+			AddStored(stmt.get(), defs->backpackStored);
 			stmt->addString("[false,false,false,false,false,false,false,12000,[],[0,0],0]");
-			stmt->addInt32(serverId);
 
 			bool exRes = stmt->directExecute(); //need sync as we will be getting the CharacterID right after this
 			if (exRes == false)
@@ -174,7 +467,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 		//get the new character's id
 		{
 			auto newCharRes = getDB()->queryParams(
-				"select s.`id` from `survivor` s join `instance` i on s.world_id = i.world_id and i.id = %d where s.`unique_id` = '%s' and s.`is_dead` = 0", serverId, getDB()->escape(playerId).c_str());
+				"select `id` from `survivor` where `world_id` = %d and `unique_id` = '%s' and `is_dead` = 0", defs->worldId, getDB()->escape(playerId).c_str());
 			if (!newCharRes || !newCharRes->fetchRow())
 			{
 				_logger.error("Error fetching created character for playerId " + playerId);
@@ -187,45 +480,56 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 		_logger.information("Created a new character " + lexical_cast<string>(characterId) + " for player '" + playerName + "' (" + playerId + ")" );
 	}
 
-	//always push back full login details
-	Sqf::Parameters retVal;
-	retVal.push_back(string("PASS"));
-	retVal.push_back(newPlayer);
-	retVal.push_back(lexical_cast<string>(characterId));
-	if (!newChar)
-	{
-	retVal.push_back(worldSpace);
-	retVal.push_back(inventory);
-	retVal.push_back(backpack);
-	retVal.push_back(survival);
-	}
-	retVal.push_back(model);
-	//hive interface version
-	retVal.push_back(0.96f);
-
-	return retVal;
+	cacheLogin(info);
+	return LoginReturn(newPlayer, newChar, info);
 }
 
 Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 {
 	Sqf::Parameters retVal;
-	//get details from db
-	auto charDetRes = getDB()->queryParams(
-		"select s.`worldspace`, s.`medical`, s.`zombie_kills`, s.`headshots`, s.`survivor_kills`, s.`bandit_kills`, s.`state`, p.`humanity` "
-		"from `survivor` s join `profile` p on s.`unique_id` = p.`unique_id` where s.`id` = %d", characterId);
-
-	if (charDetRes && charDetRes->fetchRow())
-	{
-		Sqf::Value worldSpace = Sqf::Parameters(); //empty worldspace
-		Sqf::Value medical = Sqf::Parameters(); //script will fill this in if empty
-		Sqf::Value stats = lexical_cast<Sqf::Value>("[0,0,0,0]"); //killsZ, headZ, killsH, killsB
-		Sqf::Value currentState = Sqf::Parameters(); //empty state (aiming, etc)
-		int humanity = 2500;
+
+	const CharacterCache::Entry* cached = nullptr;
+	if (_charCache)
+	{
+		CharacterCache::Entry* entry = _charCache->find(characterId);
+		if (entry && entry->hasDetails)
+			cached = entry;
+
+		UInt64 lookups = _charCache->hits() + _charCache->misses();
+		if (lookups % 1000 == 0)
+			logCacheStats();
+	}
+
+	CharacterCache::Entry loaded;
+	if (!cached)
+	{
+		//the db copy has to include anything still waiting to be written
+		flushCharacter(characterId);
+
+		//get details from db
+		auto stmt = getDB()->makeStatement(_stmtFetchCharacterDetails,
+			"select s.`worldspace`, s.`medical`, s.`zombie_kills`, s.`headshots`, s.`survivor_kills`, s.`bandit_kills`, s.`state`, p.`humanity`, "
+			"s.`inventory`, s.`backpack`, s.`model` "
+			"from `survivor` s join `profile` p on s.`unique_id` = p.`unique_id` where s.`id` = ?");
+		stmt->addInt32(characterId);
+		auto charDetRes = stmt->query();
+
+		if (!charDetRes || !charDetRes->fetchRow())
+		{
+			retVal.push_back(string("ERROR"));
+			return retVal;
+		}
+
+		loaded.worldSpace = Sqf::Parameters(); //empty worldspace
+		loaded.medical = Sqf::Parameters(); //script will fill this in if empty
+		loaded.state = Sqf::Parameters(); //empty state (aiming, etc)
+		loaded.inventory = lexical_cast<Sqf::Value>("[]");
+		loaded.backpack = lexical_cast<Sqf::Value>("[]");
 		//get stuff from row
 		{
 			try
 			{
-				worldSpace = lexical_cast<Sqf::Value>(charDetRes->at(0).getString());
+				loaded.worldSpace = lexical_cast<Sqf::Value>(charDetRes->at(0).getString());
 			}
 			catch(bad_lexical_cast)
 			{
@@ -233,7 +537,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 			}
 			try
 			{
-				medical = lexical_cast<Sqf::Value>(charDetRes->at(1).getString());
+				loaded.medical = Sqf::FromStorage(charDetRes->at(1).getString());
 			}
 			catch(bad_lexical_cast)
 			{
@@ -241,164 +545,693 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 			}
 			//set stats
 			{
-				Sqf::Parameters& statsArr = boost::get<Sqf::Parameters>(stats);
-				statsArr[0] = charDetRes->at(2).getInt32();
-				statsArr[1] = charDetRes->at(3).getInt32();
-				statsArr[2] = charDetRes->at(4).getInt32();
-				statsArr[3] = charDetRes->at(5).getInt32();
+				loaded.stats[0] = charDetRes->at(2).getInt32();
+				loaded.stats[1] = charDetRes->at(3).getInt32();
+				loaded.stats[2] = charDetRes->at(4).getInt32();
+				loaded.stats[3] = charDetRes->at(5).getInt32();
 			}
 			try
 			{
-				currentState = lexical_cast<Sqf::Value>(charDetRes->at(6).getString());
+				loaded.state = lexical_cast<Sqf::Value>(charDetRes->at(6).getString());
 			}
 			catch(bad_lexical_cast)
 			{
 				_logger.warning("Invalid CurrentState (detail load) for CharacterID("+lexical_cast<string>(characterId)+"): "+charDetRes->at(6).getString());
 			}
-			humanity = charDetRes->at(7).getInt32();
+			loaded.humanity = charDetRes->at(7).getInt32();
+			//only kept for the cache, failures just leave the defaults
+			try { if (!charDetRes->at(8).isNull()) loaded.inventory = Sqf::FromStorage(charDetRes->at(8).getString()); } catch(bad_lexical_cast) {}
+			try { if (!charDetRes->at(9).isNull()) loaded.backpack = Sqf::FromStorage(charDetRes->at(9).getString()); } catch(bad_lexical_cast) {}
+			loaded.model = charDetRes->at(10).getString();
 		}
+		loaded.hasDetails = true;
 
-		retVal.push_back(string("PASS"));
-		retVal.push_back(medical);
-		retVal.push_back(stats);
-		retVal.push_back(currentState);
-		retVal.push_back(worldSpace);
-		retVal.push_back(humanity);
+		//the flush above (or an earlier write) may not have reached the db before the read, so only a row read after them gets cached
+		cached = &loaded;
+		if (_charCache && writesLanded(characterId))
+			_charCache->insert(characterId) = loaded;
 	}
-	else
+
+	Sqf::Value stats = lexical_cast<Sqf::Value>("[0,0,0,0]"); //killsZ, headZ, killsH, killsB
 	{
-		retVal.push_back(string("ERROR"));
+		Sqf::Parameters& statsArr = boost::get<Sqf::Parameters>(stats);
+		for (int i=0;i<4;i++)
+			statsArr[i] = cached->stats[i];
 	}
 
+	retVal.push_back(string("PASS"));
+	retVal.push_back(cached->medical);
+	retVal.push_back(stats);
+	retVal.push_back(cached->state);
+	retVal.push_back(cached->worldSpace);
+	retVal.push_back(cached->humanity);
+
 	return retVal;
 }
 
-bool SqlCharDataSource::updateCharacter( int characterId, const FieldsType& fields )
+void SqlCharDataSource::noteWrite( int characterId )
+{
+	if (!_charCache)
+		return;
+
+	_writeTickets[characterId] = getDB()->asyncWriteTicket(characterId);
+
+	//characters that logged off keep their ticket until pruned here
+	if (_writeTickets.size() > 2*_charCache->capacity())
+	{
+		for (auto it=_writeTickets.begin();it!=_writeTickets.end();)
+		{
+			if (getDB()->asyncWriteDone(it->first,it->second))
+				it = _writeTickets.erase(it);
+			else
+				++it;
+		}
+	}
+}
+
+bool SqlCharDataSource::writesLanded( int characterId )
+{
+	auto it = _writeTickets.find(characterId);
+	if (it == _writeTickets.end())
+		return true;
+
+	if (!getDB()->asyncWriteDone(characterId,it->second))
+		return false;
+
+	_writeTickets.erase(it);
+	return true;
+}
+
+void SqlCharDataSource::updateCachedCharacter( int characterId, const FieldsType& fields )
 {
-	map<string,string> sqlFields;
+	CharacterCache::Entry* entry = _charCache->peek(characterId);
+	if (!entry)
+		return;
 
 	for (auto it=fields.begin();it!=fields.end();++it)
 	{
 		const string& name = it->first;
 		const Sqf::Value& val = it->second;
 
-		//arrays
-		if (name == "worldspace" || name == "inventory" || name == "backpack" || name == "medical" || name == "state")
-			sqlFields[name] = "'"+getDB()->escape(lexical_cast<string>(val))+"'";
-		//booleans
-		else if (name == "just_ate" || name == "just_drank")
+		if (name == "worldspace")
+			entry->worldSpace = val;
+		else if (name == "inventory")
+			entry->inventory = val;
+		else if (name == "backpack")
+			entry->backpack = val;
+		else if (name == "medical")
+			entry->medical = val;
+		else if (name == "state")
+			entry->state = val;
+		else if (name == "model")
+			entry->model = boost::get<string>(val);
+		else
 		{
-			if (boost::get<bool>(val))
-			{
-				string newName = "last_ate";
-				if (name == "just_drank")
-					newName = "last_drank";
+			int* counter = nullptr;
+			if (name == "zombie_kills")
+				counter = &entry->stats[0];
+			else if (name == "headshots")
+				counter = &entry->stats[1];
+			else if (name == "survivor_kills")
+				counter = &entry->stats[2];
+			else if (name == "bandit_kills")
+				counter = &entry->stats[3];
+			else if (name == "humanity")
+				counter = &entry->humanity;
 
-				sqlFields[newName] = "CURRENT_TIMESTAMP";
-			}
+			if (counter)
+				*counter += static_cast<int>(Sqf::GetDouble(val));
 		}
-		//addition integeroids
-		else if (name == "zombie_kills" || name == "headshots" || name == "DistanceFoot" || name == "survival_time" ||
-			name == "survivor_kills" || name == "bandit_kills" || name == "humanity")
+	}
+}
+
+namespace
+{
+	bool IsAdditiveField( const string& name )
+	{
+		return (name == "zombie_kills" || name == "headshots" || name == "DistanceFoot" || name == "survival_time" ||
+			name == "survivor_kills" || name == "bandit_kills" || name == "humanity");
+	}
+};
+
+void SqlCharDataSource::MergeFields( FieldsType& into, const FieldsType& from )
+{
+	for (auto it=from.begin();it!=from.end();++it)
+	{
+		const string& name = it->first;
+		auto existing = into.find(name);
+		if (existing == into.end())
+			into.insert(*it);
+		//counters are deltas, so they add up, each one truncated as it would have been if written on its own
+		else if (IsAdditiveField(name))
+			existing->second = static_cast<double>(static_cast<int>(Sqf::GetDouble(existing->second)) + static_cast<int>(Sqf::GetDouble(it->second)));
+		//just_ate/just_drank only ever come in as true
+		else
+			existing->second = it->second;
+	}
+}
+
+bool SqlCharDataSource::updateCharacter( int characterId, const FieldsType& fields )
+{
+	if (_charCache)
+		updateCachedCharacter(characterId, fields);
+
+	flushLogEntries(false);
+
+	if (_coalesceMS == 0)
+		return writeCharacter(characterId, fields);
+
+	auto it = _pending.find(characterId);
+	if (it == _pending.end())
+	{
+		PendingUpdate& pend = _pending[characterId];
+		pend.queued = GlobalTimer::getMSTime();
+		pend.fields = fields;
+	}
+	else
+		MergeFields(it->second.fields, fields);
+
+	flushPending(false);
+	return true;
+}
+
+void SqlCharDataSource::flushCharacter( int characterId )
+{
+	auto it = _pending.find(characterId);
+	if (it == _pending.end())
+		return;
+
+	FieldsType fields;
+	fields.swap(it->second.fields);
+	_pending.erase(it);
+	writeCharacter(characterId, fields);
+}
+
+void SqlCharDataSource::flushPending( bool all )
+{
+	UInt32 now = GlobalTimer::getMSTime();
+	PendingBatch due;
+	for (auto it=_pending.begin();it!=_pending.end();)
+	{
+		if (all || GlobalTimer::getMSTimeDiff(it->second.queued,now) >= _coalesceMS)
 		{
-			int integeroid = static_cast<int>(Sqf::GetDouble(val));
-			char intSign = '+';
-			if (integeroid < 0)
-			{
-				intSign = '-';
-				integeroid = abs(integeroid);
-			}
+			due.push_back(PendingBatch::value_type(it->first,PendingUpdate()));
+			due.back().second.queued = it->second.queued;
+			due.back().second.fields.swap(it->second.fields);
+			_pending.erase(it++);
+		}
+		else
+			++it;
+	}
 
-			if (integeroid != 0 && name != "humanity")
-				sqlFields[name] = "(s.`"+name+"` "+intSign+" "+lexical_cast<string>(integeroid)+")";
-			//humanity references another table
-			else if (integeroid != 0)
-				sqlFields[name] = "(p.`"+name+"` "+intSign+" "+lexical_cast<string>(integeroid)+")";
+	if (due.size() > 1 && _batchFlush)
+	{
+		writeCharacterBatch(due);
+		return;
+	}
+	for (auto it=due.begin();it!=due.end();++it)
+		writeCharacter(it->first, it->second.fields);
+}
+
+namespace
+{
+	enum UpdateColumnKind
+	{
+		UPDATE_SQF, //arrays, bound as their sqf text
+		UPDATE_STORED, //arrays that may be kept in binary form
+		UPDATE_STRING,
+		UPDATE_TIMESTAMP, //booleans that set a column to the current time
+		UPDATE_ADD,
+		UPDATE_ADD_PROFILE //humanity lives on the profile
+	};
+	struct UpdateColumn
+	{
+		const char* field;
+		const char* column;
+		UpdateColumnKind kind;
+	};
+	//the bit of each column in a statement shape is its index in here
+	const UpdateColumn UPDATE_COLUMNS[] =
+	{
+		{ "worldspace", nullptr, UPDATE_SQF }, //column is configurable
+		{ "inventory", "inventory", UPDATE_STORED },
+		{ "backpack", "backpack", UPDATE_STORED },
+		{ "medical", "medical", UPDATE_STORED },
+		{ "state", "state", UPDATE_SQF },
+		{ "model", "model", UPDATE_STRING },
+		{ "just_ate", "last_ate", UPDATE_TIMESTAMP },
+		{ "just_drank", "last_drank", UPDATE_TIMESTAMP },
+		{ "zombie_kills", "zombie_kills", UPDATE_ADD },
+		{ "headshots", "headshots", UPDATE_ADD },
+		{ "DistanceFoot", "DistanceFoot", UPDATE_ADD },
+		{ "survival_time", "survival_time", UPDATE_ADD },
+		{ "survivor_kills", "survivor_kills", UPDATE_ADD },
+		{ "bandit_kills", "bandit_kills", UPDATE_ADD },
+		{ "humanity", "humanity", UPDATE_ADD_PROFILE }
+	};
+	const size_t NUM_UPDATE_COLUMNS = sizeof(UPDATE_COLUMNS)/sizeof(UPDATE_COLUMNS[0]);
+};
+
+const string& SqlCharDataSource::updateShapeSql( UInt32 mask )
+{
+	UpdateShape& shape = _updateShapes[mask];
+	if (shape.sql.length() > 0)
+		return shape.sql;
+
+	string setClause = "";
+	bool joinProfile = false;
+	for (size_t i=0;i<NUM_UPDATE_COLUMNS;i++)
+	{
+		if ((mask & (1 << i)) == 0)
+			continue;
+
+		const UpdateColumn& col = UPDATE_COLUMNS[i];
+		string colName = col.column ? col.column : _wsFieldName;
+		string colRef = "s.`" + colName + "`";
+		if (col.kind == UPDATE_ADD_PROFILE)
+		{
+			joinProfile = true;
+			colRef = "p.`" + colName + "`";
 		}
-		//strings
-		else if (name == "model")
+
+		if (setClause.length() > 0)
+			setClause += " , ";
+
+		if (col.kind == UPDATE_TIMESTAMP)
+			setClause += colRef + " = CURRENT_TIMESTAMP";
+		else if (col.kind == UPDATE_ADD || col.kind == UPDATE_ADD_PROFILE)
+			setClause += colRef + " = (" + colRef + " + ?)";
+		else
+			setClause += colRef + " = ?";
+	}
+
+	shape.sql = "update `survivor` s ";
+	if (joinProfile)
+		shape.sql += "join `profile` p on s.`unique_id` = p.`unique_id` ";
+	shape.sql += "set " + setClause + " where s.`id` = ?";
+	return shape.sql;
+}
+
+bool SqlCharDataSource::writeCharacter( int characterId, const FieldsType& fields )
+{
+	//work out which columns are set, the combination picks the prepared statement
+	const Sqf::Value* values[NUM_UPDATE_COLUMNS];
+	int deltas[NUM_UPDATE_COLUMNS];
+	UInt32 mask = 0;
+	for (auto it=fields.begin();it!=fields.end();++it)
+	{
+		const string& name = it->first;
+		const Sqf::Value& val = it->second;
+
+		size_t idx = 0;
+		while (idx < NUM_UPDATE_COLUMNS && name != UPDATE_COLUMNS[idx].field)
+			idx++;
+		if (idx >= NUM_UPDATE_COLUMNS)
+			continue;
+
+		switch (UPDATE_COLUMNS[idx].kind)
 		{
-			sqlFields[name] = "'"+getDB()->escape(boost::get<string>(val))+"'";
+		case UPDATE_TIMESTAMP:
+			if (!boost::get<bool>(val))
+				continue;
+			break;
+		case UPDATE_ADD:
+		case UPDATE_ADD_PROFILE:
+			deltas[idx] = static_cast<int>(Sqf::GetDouble(val));
+			if (deltas[idx] == 0)
+				continue;
+			break;
+		default:
+			break;
 		}
+		values[idx] = &val;
+		mask |= (1 << idx);
 	}
 
-	if (sqlFields.size() > 0)
+	if (mask == 0)
+		return true;
+
+	const string& sql = updateShapeSql(mask);
+	auto stmt = getDB()->makeStatement(_updateShapes[mask].id, sql);
+	for (size_t i=0;i<NUM_UPDATE_COLUMNS;i++)
+	{
+		if ((mask & (1 << i)) == 0)
+			continue;
+
+		switch (UPDATE_COLUMNS[i].kind)
+		{
+		case UPDATE_SQF:
+			stmt->addString(lexical_cast<string>(*values[i]));
+			break;
+		case UPDATE_STORED:
+			AddStored(stmt.get(), Sqf::ToStorage(*values[i], _binaryStorage));
+			break;
+		case UPDATE_STRING:
+			stmt->addString(boost::get<string>(*values[i]));
+			break;
+		case UPDATE_ADD:
+		case UPDATE_ADD_PROFILE:
+			stmt->addInt32(deltas[i]);
+			break;
+		default:
+			break;
+		}
+	}
+	stmt->addInt32(characterId);
+	stmt->setShardKey(characterId);
+
+	bool exRes = stmt->execute();
+	poco_assert(exRes == true);
+	noteWrite(characterId);
+
+	return exRes;
+}
+
+bool SqlCharDataSource::batchRow( int characterId, const FieldsType& fields, string& out, string& named, bool& usesProfile ) const
+{
+	string vals[NUM_UPDATE_COLUMNS];
+	bool any = false;
+	for (size_t i=0;i<NUM_UPDATE_COLUMNS;i++)
 	{
-		string setClause = "";
-		bool joinProfile = false;
-		for (auto it=sqlFields.begin();it!=sqlFields.end();)
+		const UpdateColumn& col = UPDATE_COLUMNS[i];
+		auto it = fields.find(col.field);
+		switch (col.kind)
 		{
-			string fieldName = it->first;
-			if (fieldName == "worldspace")
-				fieldName = _wsFieldName;
-
-			if (fieldName == "humanity") {
-				joinProfile = true;
-				setClause += "p.`" + fieldName + "` = " + it->second;
-			} else {
-				setClause += "s.`" + fieldName + "` = " + it->second;
+		case UPDATE_SQF:
+		case UPDATE_STORED:
+		case UPDATE_STRING:
+			vals[i] = "NULL"; //keeps the current value
+			if (it != fields.end())
+			{
+				string text;
+				if (col.kind == UPDATE_STORED)
+					text = Sqf::ToStorage(it->second, _binaryStorage);
+				else if (col.kind == UPDATE_SQF)
+					text = lexical_cast<string>(it->second);
+				else
+					text = boost::get<string>(it->second);
+
+				vals[i] = storedLiteral(text);
+				any = true;
 			}
-			++it;
-			if (it != sqlFields.end())
-				setClause += " , ";
+			break;
+		case UPDATE_TIMESTAMP:
+			vals[i] = "0";
+			if (it != fields.end() && boost::get<bool>(it->second))
+			{
+				vals[i] = "1";
+				any = true;
+			}
+			break;
+		default:
+			{
+				int delta = (it != fields.end()) ? static_cast<int>(Sqf::GetDouble(it->second)) : 0;
+				vals[i] = lexical_cast<string>(delta);
+				if (delta != 0)
+				{
+					any = true;
+					if (col.kind == UPDATE_ADD_PROFILE)
+						usesProfile = true;
+				}
+			}
+			break;
 		}
+	}
+	if (!any)
+		return false;
 
-		string query = "update `survivor` s ";
-		if (joinProfile)
-			query += "join `profile` p on s.`unique_id` = p.`unique_id` ";
-		query += "set " + setClause + " where s.`id` = " + lexical_cast<string>(characterId);
-		bool exRes = getDB()->execute(query.c_str());
+	//the first row of the union names the columns, so the named form is also the one that stands alone
+	out = "select " + lexical_cast<string>(characterId);
+	named = out + " as `id`";
+	for (size_t i=0;i<NUM_UPDATE_COLUMNS;i++)
+	{
+		out += ", " + vals[i];
+		named += ", " + vals[i] + " as `" + UPDATE_COLUMNS[i].field + "`";
+	}
+	return true;
+}
+
+bool SqlCharDataSource::writeCharacterBatch( const PendingBatch& batch )
+{
+	UInt32 startTime = GlobalTimer::getMSTime();
+	UInt32 oldestWait = 0;
+	size_t maxBytes = getDB()->maxStatementBytes();
+
+	//all of the characters are joined against one derived table, so each statement is one round trip
+	//INSERT ... ON DUPLICATE KEY UPDATE isn't usable here, survivor has required columns that an update never carries
+	//and humanity lives on profile
+	size_t numChars = 0;
+	size_t numStmts = 0;
+	size_t numBytes = 0;
+	bool allOk = true;
+
+	//the set clause doesn't depend on the rows, so it's built up front and counted against the packet limit
+	string setClause[2];
+	for (int withProfile=0;withProfile<2;withProfile++)
+	{
+		string& sql = setClause[withProfile];
+		sql = "set ";
+		for (size_t i=0;i<NUM_UPDATE_COLUMNS;i++)
+		{
+			const UpdateColumn& col = UPDATE_COLUMNS[i];
+			if (col.kind == UPDATE_ADD_PROFILE && !withProfile)
+				continue;
+
+			string src = string("u.`") + col.field + "`";
+			string dst = "s.`" + (col.column ? string(col.column) : _wsFieldName) + "`";
+			if (col.kind == UPDATE_ADD_PROFILE)
+				dst = string("p.`") + col.column + "`";
+
+			if (i > 0)
+				sql += " , ";
+			if (col.kind == UPDATE_TIMESTAMP)
+				sql += dst + " = if(" + src + ", CURRENT_TIMESTAMP, " + dst + ")";
+			else if (col.kind == UPDATE_ADD || col.kind == UPDATE_ADD_PROFILE)
+				sql += dst + " = (" + dst + " + " + src + ")";
+			else
+				sql += dst + " = coalesce(" + src + ", " + dst + ")";
+		}
+	}
+	static const string profileJoin = "left join `profile` p on s.`unique_id` = p.`unique_id` ";
+	static const string unionSep = " union all ";
+	auto buildSql = [&](const string& rowsSql, bool withProfile) -> string
+	{
+		string sql = "update `survivor` s join (" + rowsSql + ") u on s.`id` = u.`id` ";
+		if (withProfile)
+			sql += profileJoin;
+		sql += setClause[withProfile ? 1 : 0];
+		return sql;
+	};
+	const size_t overhead = buildSql("", true).length() + unionSep.length();
+
+	string rows;
+	//each row on its own, run in place of the statement if it fails
+	vector<string> singles;
+	vector<int> stmtChars;
+	bool usesProfile = false;
+	int shardKey = 0;
+	auto emitStatement = [&]()
+	{
+		if (rows.length() < 1)
+			return;
+
+		string sql = buildSql(rows, usesProfile);
+		bool exRes = getDB()->executeKeyedSplit(shardKey, sql.c_str(), singles);
 		poco_assert(exRes == true);
+		allOk = allOk && exRes;
+		for (size_t i=0;i<stmtChars.size();i++)
+			noteWrite(stmtChars[i]);
 
-		return exRes;
+		numStmts++;
+		numBytes += sql.length();
+		rows.clear();
+		singles.clear();
+		stmtChars.clear();
+		usesProfile = false;
+	};
+
+	//statements are split by async writer, so every character's row stays in order with its other keyed writes
+	map<size_t, vector<const PendingBatch::value_type*> > byShard;
+	for (auto it=batch.begin();it!=batch.end();++it)
+		byShard[getDB()->asyncShardOf(it->first)].push_back(&(*it));
+
+	for (auto shardIt=byShard.begin();shardIt!=byShard.end();++shardIt)
+	{
+		shardKey = shardIt->second.front()->first;
+		for (auto rowIt=shardIt->second.begin();rowIt!=shardIt->second.end();++rowIt)
+		{
+			const PendingBatch::value_type& pend = **rowIt;
+			oldestWait = std::max(oldestWait,GlobalTimer::getMSTimeDiff(pend.second.queued,startTime));
+
+			string row, named;
+			bool rowProfile = false;
+			if (!batchRow(pend.first, pend.second.fields, row, named, rowProfile))
+				continue;
+
+			//start a new statement before this row would push us over the packet limit
+			if (rows.length() > 0 && rows.length() + named.length() + overhead > maxBytes)
+				emitStatement();
+
+			if (rows.length() > 0)
+				rows += unionSep + row;
+			else
+				rows = named;
+			singles.push_back(buildSql(named, rowProfile));
+			stmtChars.push_back(pend.first);
+			usesProfile = usesProfile || rowProfile;
+			numChars++;
+		}
+		emitStatement();
 	}
 
-	return true;
+	if (_logger.debug())
+	{
+		_logger.debug("Flushed " + lexical_cast<string>(numChars) + " characters in " + lexical_cast<string>(numStmts) + " statements (" +
+			lexical_cast<string>(numBytes) + " bytes) in " + lexical_cast<string>(GlobalTimer::getMSTimeDiff(startTime,GlobalTimer::getMSTime())) + 
+			"ms, oldest change waited " + lexical_cast<string>(oldestWait) + "ms");
+	}
+
+	return allOk;
 }
 
 bool SqlCharDataSource::initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack )
 {
-	auto stmt = getDB()->makeStatement(_stmtInitCharacter, "UPDATE `survivor` SET `inventory` = ? , `backpack` = ? WHERE `unique_id` = ?");
-	stmt->addString(lexical_cast<string>(inventory));
-	stmt->addString(lexical_cast<string>(backpack));
+	//a pending inventory update must not land on top of this one
+	flushCharacter(characterId);
+
+	auto stmt = getDB()->makeStatement(_stmtInitCharacter, "UPDATE `survivor` SET `inventory` = ? , `backpack` = ? WHERE `id` = ?");
+	AddStored(stmt.get(), Sqf::ToStorage(inventory, _binaryStorage));
+	AddStored(stmt.get(), Sqf::ToStorage(backpack, _binaryStorage));
 	stmt->addInt32(characterId);
+	stmt->setShardKey(characterId);
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
+	noteWrite(characterId);
+
+	if (exRes && _charCache)
+	{
+		if (CharacterCache::Entry* entry = _charCache->peek(characterId))
+		{
+			entry->inventory = inventory;
+			entry->backpack = backpack;
+		}
+	}
 	return exRes;
 }
 
 bool SqlCharDataSource::killCharacter( int characterId, int duration )
 {
-	auto stmt = getDB()->makeStatement(_stmtKillStatCharacter, 
-		"update `profile` p inner join `survivor` s on s.`unique_id` = p.`unique_id` set p.`survival_attempts` = p.`survival_attempts` + 1, p.`total_survivor_kills` = p.`total_survivor_kills` + s.`survivor_kills`, p.`total_bandit_kills` = p.`total_bandit_kills` + s.`bandit_kills`, p.`total_zombie_kills` = p.`total_zombie_kills` + s.`zombie_kills`, p.`total_headshots` = p.`total_headshots` + s.`headshots`, p.`total_survival_time` = p.`total_survival_time` + s.`survival_time` where s.`id` = ?");
+	//the death stats are summed from the survivor row, so it has to be current
+	//both are keyed by the character, so the flush lands before the death on the same writer
+	flushCharacter(characterId);
+
+	//stats rollup and death in one statement, the is_dead guard makes a repeated death a no-op
+	auto stmt = getDB()->makeStatement(_stmtKillCharacter, 
+		"update `profile` p inner join `survivor` s on s.`unique_id` = p.`unique_id` set p.`survival_attempts` = p.`survival_attempts` + 1, p.`total_survivor_kills` = p.`total_survivor_kills` + s.`survivor_kills`, p.`total_bandit_kills` = p.`total_bandit_kills` + s.`bandit_kills`, p.`total_zombie_kills` = p.`total_zombie_kills` + s.`zombie_kills`, p.`total_headshots` = p.`total_headshots` + s.`headshots`, p.`total_survival_time` = p.`total_survival_time` + greatest(s.`survival_time`, ?), s.`is_dead` = 1 where s.`id` = ? and s.`is_dead` = 0");
+	stmt->addInt32(duration);
 	stmt->addInt32(characterId);
+	stmt->setShardKey(characterId);
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
 
-	stmt = getDB()->makeStatement(_stmtKillCharacter, "update `survivor` set `is_dead` = 1 where `id` = ?");
-	stmt->addInt32(characterId);
-	exRes = stmt->execute();
-	poco_assert(exRes == true);
+	//dead characters are never fetched again
+	if (_charCache)
+		_charCache->remove(characterId);
+	_writeTickets.erase(characterId);
 
 	return exRes;
 }
 
 bool SqlCharDataSource::recordLogEntry( string playerId, int characterId, int serverId, int action )
 {
-	auto stmt = getDB()->makeStatement(_stmtRecordLogin, 
-		"insert into `log_entry` (`unique_id`, `log_code_id`, `instance_id`) select ?, lc.id, ? from log_code lc where lc.name = ?");
-	stmt->addString(playerId);
-	stmt->addInt32(serverId);
-	switch (action) {
-	case 0:
-		stmt->addString("Login");
-		break;
-	case 2:
-		stmt->addString("Disconnect");
-		break;
+	if (action == 2 && characterId > 0) //disconnect
+		flushCharacter(characterId);
+	flushPending(false);
+
+	//codes are looked up once (again only if the lookup itself failed), the rows are then written in bulk
+	if (_logBatchSize > 1 && !_logCodesLoaded)
+	{
+		auto codesRes = getDB()->query("select `id`, `name` from `log_code`");
+		while (codesRes && codesRes->fetchRow())
+		{
+			string name = codesRes->at(1).getString();
+			if (name == "Login")
+				_logCodes[0] = codesRes->at(0).getInt32();
+			else if (name == "Disconnect")
+				_logCodes[2] = codesRes->at(0).getInt32();
+		}
+		_logCodesLoaded = (codesRes != nullptr);
+		if (_logCodesLoaded && (_logCodes.count(0) < 1 || _logCodes.count(2) < 1))
+			_logger.warning("Login/Disconnect missing from log_code, those entries won't be buffered");
 	}
-	bool exRes = stmt->execute();
-	poco_assert(exRes == true);
 
-	return exRes;
+	auto codeIt = _logCodes.find(action);
+	if (_logBatchSize <= 1 || codeIt == _logCodes.end())
+	{
+		auto stmt = getDB()->makeStatement(_stmtRecordLogin, 
+			"insert into `log_entry` (`unique_id`, `log_code_id`, `instance_id`) select ?, lc.id, ? from log_code lc where lc.name = ?");
+		stmt->addString(playerId);
+		stmt->addInt32(serverId);
+		switch (action) {
+		case 0:
+			stmt->addString("Login");
+			break;
+		case 2:
+			stmt->addString("Disconnect");
+			break;
+		}
+		bool exRes = stmt->execute();
+		poco_assert(exRes == true);
+
+		return exRes;
+	}
+
+	{
+		Poco::FastMutex::ScopedLock guard(_logLock);
+		if (_logBuffer.empty())
+			_logBufferStart = GlobalTimer::getMSTime();
+
+		LogEntry entry;
+		entry.playerId = playerId;
+		entry.serverId = serverId;
+		entry.codeId = codeIt->second;
+		_logBuffer.push_back(entry);
+	}
+
+	flushLogEntries(false);
+	return true;
+}
+
+void SqlCharDataSource::runLogFlusher()
+{
+	getDB()->threadEnter();
+	//checking twice per interval, nothing waits much longer than LogFlushMS
+	long waitMS = std::max(_logFlushMS/2,UInt32(1));
+	while (!_logStop.tryWait(waitMS))
+		flushLogEntries(false);
+	getDB()->threadExit();
+}
+
+void SqlCharDataSource::flushLogEntries( bool all )
+{
+	Poco::FastMutex::ScopedLock guard(_logLock);
+	if (_logBuffer.empty())
+		return;
+
+	if (!all && _logBuffer.size() < _logBatchSize && 
+		GlobalTimer::getMSTimeDiff(_logBufferStart,GlobalTimer::getMSTime()) < _logFlushMS)
+		return;
+
+	auto stmt = getDB()->makeStatement(_stmtInsertLogEntry, "insert into `log_entry` (`unique_id`, `log_code_id`, `instance_id`) values (?, ?, ?)");
+	for (auto it=_logBuffer.begin();it!=_logBuffer.end();++it)
+	{
+		stmt->addString(it->playerId);
+		stmt->addInt32(it->codeId);
+		stmt->addInt32(it->serverId);
+		stmt->addRow();
+	}
+	_logBuffer.clear();
+
+	bool exRes = stmt->executeBulk();
+	poco_assert(exRes == true);
 }
@@ -21,11 +21,19 @@
 #include "SqlDataSource.h"
 #include "CharDataSource.h"
 #include "Database/SqlStatement.h"
+#include "CharacterCache.h"
 
+#include <Poco/Thread.h>
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/RunnableAdapter.h>
+
+namespace Poco { namespace Util { class AbstractConfiguration; }; };
+class QueryResult;
 class SqlCharDataSource : public SqlDataSource, public CharDataSource
 {
 public:
-	SqlCharDataSource(Poco::Logger& logger, shared_ptr<Database> db, const string& idFieldName, const string& wsFieldName);
+	SqlCharDataSource(Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf);
 	~SqlCharDataSource();
 
 	Sqf::Value fetchCharacterInitial( string playerId, int serverId, const string& playerName ) override;
@@ -34,10 +42,111 @@ public:
 	bool initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack ) override;
 	bool killCharacter( int characterId, int duration ) override;
 	bool recordLogEntry( string playerId, int characterId, int serverId, int action ) override;
+	bool reloadInstanceDefaults( int serverId ) override;
 
 private:
 	string _idFieldName;
 	string _wsFieldName;
+	bool _loginProcedure;
+	bool _binaryStorage; //inventory, backpack and medical
+
+	struct LoginInfo
+	{
+		int characterId;
+		Sqf::Value worldSpace;
+		Sqf::Value inventory;
+		Sqf::Value backpack;
+		Sqf::Value survival;
+		string model;
+	};
+	//reads id, worldspace, inventory, backpack, 3 survival timings and model starting at firstCol
+	void parseLoginFields( QueryResult* res, size_t firstCol, LoginInfo& out ) const;
+	static Sqf::Parameters LoginReturn( bool newPlayer, bool newChar, const LoginInfo& info );
+	bool fetchCharacterInitialProc( const string& playerId, int serverId, const string& playerName, Sqf::Parameters& retVal );
+
+	//updates are merged per character and written at most once per window
+	UInt32 _coalesceMS;
+	struct PendingUpdate
+	{
+		UInt32 queued;
+		FieldsType fields;
+	};
+	typedef map<int,PendingUpdate> PendingMap;
+	PendingMap _pending;
+
+	static void MergeFields( FieldsType& into, const FieldsType& from );
+	//one prepared statement per combination of updated columns
+	struct UpdateShape
+	{
+		SqlStatementID id;
+		string sql;
+	};
+	typedef unordered_map<UInt32,UpdateShape> UpdateShapeMap;
+	UpdateShapeMap _updateShapes;
+	const string& updateShapeSql( UInt32 mask );
+	bool writeCharacter( int characterId, const FieldsType& fields );
+	void flushCharacter( int characterId );
+	//writes updates older than the window, or all of them
+	void flushPending( bool all );
+
+	//due characters are written together as one joined update per packet
+	bool _batchFlush;
+	typedef vector< std::pair<int,PendingUpdate> > PendingBatch;
+	bool writeCharacterBatch( const PendingBatch& batch );
+	bool batchRow( int characterId, const FieldsType& fields, string& out, string& named, bool& usesProfile ) const;
+
+	//unique_id -> current name, so logins by known players skip the profile query
+	unordered_map<string,string> _profileNames;
+	size_t _profileCacheSize;
+	int _profilePreloadDays;
+	void cacheProfile( const string& playerId, const string& playerName );
+	void preloadProfiles();
+
+	//new characters are created from these, loaded once per instance and refreshed periodically
+	struct InstanceDefaults
+	{
+		int worldId;
+		Sqf::Value inventory;
+		Sqf::Value backpack;
+		//in the configured storage form
+		string inventoryStored;
+		string backpackStored;
+		UInt32 loadedAt;
+	};
+	map<int,InstanceDefaults> _instanceDefaults;
+	UInt32 _instanceRefreshMS;
+	const InstanceDefaults* instanceDefaults( int serverId );
+
+	//login/disconnect records are buffered and inserted as one multi-row statement
+	struct LogEntry
+	{
+		string playerId;
+		int serverId;
+		int codeId;
+	};
+	vector<LogEntry> _logBuffer;
+	UInt32 _logBufferStart;
+	size_t _logBatchSize;
+	UInt32 _logFlushMS;
+	//looked up once, actions without a code are written with the per-event insert
+	bool _logCodesLoaded;
+	map<int,int> _logCodes; //action -> log_code id
+	//the buffer is also flushed on its own thread, so entries don't wait for the next login/logout to be written
+	Poco::FastMutex _logLock;
+	Poco::Thread _logThread;
+	Poco::Event _logStop;
+	Poco::RunnableAdapter<SqlCharDataSource> _logFlusher;
+	void runLogFlusher();
+	void flushLogEntries( bool all );
+
+	unique_ptr<CharacterCache> _charCache;
+	void cacheLogin( const LoginInfo& info );
+	void updateCachedCharacter( int characterId, const FieldsType& fields );
+	//ticket of the last keyed write per character, a detail row is only cached once those writes have run
+	unordered_map<int,UInt64> _writeTickets;
+	void noteWrite( int characterId );
+	bool writesLanded( int characterId );
+	void logCacheStats();
 
 	//statement ids
 	SqlStatementID _stmtChangePlayerName;
@@ -45,7 +154,10 @@ private:
 	SqlStatementID _stmtUpdateCharacterLastLogin;
 	SqlStatementID _stmtInsertNewCharacter;
 	SqlStatementID _stmtInitCharacter;
-	SqlStatementID _stmtKillStatCharacter;
 	SqlStatementID _stmtKillCharacter;
 	SqlStatementID _stmtRecordLogin;
+	SqlStatementID _stmtInsertLogEntry;
+	SqlStatementID _stmtFetchPlayerName;
+	SqlStatementID _stmtFetchLoginCharacter;
+	SqlStatementID _stmtFetchCharacterDetails;
 };
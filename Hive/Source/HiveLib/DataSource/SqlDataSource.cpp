@@ -0,0 +1,114 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlDataSource.h"
+#include "Database/Database.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+using boost::bad_lexical_cast;
+
+string SqlDataSource::storedLiteral( const string& stored ) const
+{
+	if (!Sqf::IsBinary(stored))
+		return "'" + getDB()->escape(stored) + "'";
+
+	static const char HEX_DIGITS[] = "0123456789ABCDEF";
+	string lit = "x'";
+	lit.reserve(stored.length()*2+3);
+	for (size_t i=0;i<stored.length();i++)
+	{
+		UInt8 b = static_cast<UInt8>(stored[i]);
+		lit.push_back(HEX_DIGITS[b >> 4]);
+		lit.push_back(HEX_DIGITS[b & 0x0F]);
+	}
+	lit.push_back('\'');
+	return lit;
+}
+
+size_t SqlDataSource::convertStoredColumns( const string& table, const string& keyCol, const vector<string>& columns, bool toBinary, int batchSize )
+{
+	string colList;
+	for (size_t i=0;i<columns.size();i++)
+		colList += ", `" + columns[i] + "`";
+
+	_logger.information("Converting " + table + " to " + string(toBinary ? "binary" : "text") + " storage");
+
+	Int64 cursor = 0;
+	size_t numScanned = 0;
+	size_t numConverted = 0;
+	for (;;)
+	{
+		auto rowsRes = getDB()->queryParams("select `%s`%s from `%s` where `%s` > %s order by `%s` limit %d",
+			keyCol.c_str(), colList.c_str(), table.c_str(), keyCol.c_str(), lexical_cast<string>(cursor).c_str(), keyCol.c_str(), batchSize);
+		if (!rowsRes)
+		{
+			_logger.error("Storage conversion of " + table + " failed after " + keyCol + " " + lexical_cast<string>(cursor));
+			break;
+		}
+
+		size_t batchRows = 0;
+		while (rowsRes->fetchRow())
+		{
+			cursor = rowsRes->at(0).getInt64();
+			batchRows++;
+
+			string setClause;
+			for (size_t i=0;i<columns.size();i++)
+			{
+				const Field& field = rowsRes->at(i+1);
+				if (field.isNull())
+					continue;
+
+				string stored = field.getString();
+				if (Sqf::IsBinary(stored) == toBinary)
+					continue;
+
+				try
+				{
+					string converted = Sqf::ToStorage(Sqf::FromStorage(stored), toBinary);
+					if (setClause.length() > 0)
+						setClause += ", ";
+					setClause += "`" + columns[i] + "` = " + storedLiteral(converted);
+				}
+				catch (const bad_lexical_cast&)
+				{
+					_logger.warning("Leaving invalid " + columns[i] + " of " + table + " " + keyCol + " " + lexical_cast<string>(cursor) + " unconverted");
+				}
+			}
+
+			if (setClause.length() > 0)
+			{
+				//values can be long, so this doesn't go through the fixed size format buffer
+				string query = "update `" + table + "` set " + setClause + " where `" + keyCol + "` = " + lexical_cast<string>(cursor);
+				bool exRes = getDB()->directExecute(query.c_str());
+				if (exRes)
+					numConverted++;
+			}
+		}
+
+		numScanned += batchRows;
+		if (batchRows < static_cast<size_t>(batchSize))
+			break;
+	}
+
+	_logger.information("Converted " + lexical_cast<string>(numConverted) + " of " + lexical_cast<string>(numScanned) + " rows in " + table);
+	return numConverted;
+}
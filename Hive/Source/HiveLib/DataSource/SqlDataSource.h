@@ -19,6 +19,8 @@
 #pragma once 
 
 #include "DataSource.h"
+#include "Database/SqlStatement.h"
+#include "../SqfBinary.h"
 
 class Database;
 class SqlDataSource : public DataSource
@@ -28,6 +30,19 @@ public:
 	~SqlDataSource() {}
 protected:
 	Database* getDB() const { return _db.get(); }
+
+	//binds an array column value, binary forms go in as blobs
+	static void AddStored(SqlStatement* stmt, const string& stored)
+	{
+		if (Sqf::IsBinary(stored))
+			stmt->addBinary(ByteVector(stored.begin(),stored.end()));
+		else
+			stmt->addString(stored);
+	}
+	//sql literal for an array column value, binary forms are written as hex
+	string storedLiteral(const string& stored) const;
+	//rewrites the given array columns of every row not yet in the wanted form, walking the key in batches
+	size_t convertStoredColumns(const string& table, const string& keyCol, const vector<string>& columns, bool toBinary, int batchSize = 500);
 private:
 	shared_ptr<Database> _db;
 };
\ No newline at end of file
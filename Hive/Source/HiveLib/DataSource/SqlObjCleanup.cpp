@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlObjCleanup.h"
+#include "Database/Database.h"
+#include "Shared/Common/Timer.h"
+
+#include <Poco/Logger.h>
+#include <Poco/Format.h>
+#include <Poco/Util/AbstractConfiguration.h>
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+namespace { const UInt32 PROGRESS_LOG_MS = 60*1000; };
+
+SqlObjCleanup::SqlObjCleanup( Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf, const string& depTableName )
+	: _logger(logger), _db(db), _depTableName(depTableName), _serverId(-1), _cursor(0), _thread("Object Cleanup"), _stopEvent(false)
+{
+	_placedDays = conf->getInt("CleanupPlacedAfterDays",6);
+	_orphaned = conf->getBool("CleanupOrphaned",true);
+	_batchSize = std::max(conf->getInt("CleanupBatchSize",100),1);
+	_batchIntervalMS = std::max(conf->getInt("CleanupBatchIntervalMS",500),0);
+	_passIntervalSec = std::max(conf->getInt("CleanupPassIntervalSec",600),1);
+}
+
+SqlObjCleanup::~SqlObjCleanup()
+{
+	stop();
+}
+
+void SqlObjCleanup::start( int serverId )
+{
+	if (_thread.isRunning())
+		return;
+
+	if (_placedDays <= 0 && !_orphaned)
+	{
+		_logger.information("Object cleanup enabled but has no criteria, not starting");
+		return;
+	}
+
+	_serverId = serverId;
+	_cursor = 0;
+	_stopEvent.reset();
+	_thread.start(*this);
+}
+
+void SqlObjCleanup::stop()
+{
+	_stopEvent.set();
+	if (_thread.isRunning())
+		_thread.join();
+}
+
+void SqlObjCleanup::takeDeleted( vector<Int64>& out )
+{
+	Poco::FastMutex::ScopedLock guard(_deletedLock);
+	out.insert(out.end(),_deleted.begin(),_deleted.end());
+	_deleted.clear();
+}
+
+bool SqlObjCleanup::processBatch( size_t& scanned, size_t& deleted )
+{
+	scanned = 0;
+	deleted = 0;
+	Int64 batchStart = _cursor;
+
+	//placed objects only expire once they're empty, same as the old CleanupPlacedAfterDays
+	string expiredCond = "0";
+	if (_placedDays > 0)
+	{
+		//the hex literal is [] in binary storage form
+		expiredCond = "(id.`created` < now() - interval " + lexical_cast<string>(_placedDays) + " day "
+			"and (id.`inventory` is null or id.`inventory` = '[]' or id.`inventory` = x'0053010A00'))";
+	}
+	string orphanCond = _orphaned ? "d.`id` is null" : "0";
+
+	//bounded by primary key range, so no batch touches more than _batchSize rows
+	auto candidates = _db->queryParams("select id.`id`, id.`unique_id`, (%s or %s) as doomed from `%s` id left join `deployable` d on id.`deployable_id` = d.`id` "
+		"where id.`instance_id` = %d and id.`id` > %s order by id.`id` limit %d",
+		expiredCond.c_str(), orphanCond.c_str(), _depTableName.c_str(), _serverId, lexical_cast<string>(_cursor).c_str(), _batchSize);
+
+	if (!candidates)
+	{
+		_logger.error("Object cleanup failed to fetch candidates after id " + lexical_cast<string>(_cursor));
+		return false;
+	}
+
+	string idList;
+	map<Int64,Int64> doomed;
+	while (candidates->fetchRow())
+	{
+		auto row = candidates->fields();
+		_cursor = row[0].getInt64();
+		scanned++;
+
+		if (!row[2].getBool())
+			continue;
+
+		if (!idList.empty())
+			idList += ",";
+		idList += row[0].getString();
+		doomed[row[0].getInt64()] = row[1].getInt64();
+	}
+
+	if (doomed.size() > 0)
+	{
+		//re-check the criteria in the delete itself, an object could have been filled or its owner returned since the select
+		bool exRes = _db->directExecuteParams("delete id from `%s` id left join `deployable` d on id.`deployable_id` = d.`id` "
+			"where id.`id` in (%s) and id.`instance_id` = %d and (%s or %s)",
+			_depTableName.c_str(), idList.c_str(), _serverId, expiredCond.c_str(), orphanCond.c_str());
+		if (!exRes)
+		{
+			_logger.error("Object cleanup failed to delete batch ending at id " + lexical_cast<string>(_cursor));
+			_cursor = batchStart;
+			scanned = 0;
+			return false;
+		}
+
+		//whatever is still there no longer qualified, don't report it as deleted
+		auto survivors = _db->queryParams("select `id` from `%s` where `id` in (%s)", _depTableName.c_str(), idList.c_str());
+		if (!survivors)
+		{
+			//the delete went through, so there's nothing to retry, those rows just aren't reported
+			_logger.error("Object cleanup failed to verify batch ending at id " + lexical_cast<string>(_cursor));
+			return true;
+		}
+		while (survivors->fetchRow())
+			doomed.erase(survivors->fields()[0].getInt64());
+
+		deleted = doomed.size();
+
+		Poco::FastMutex::ScopedLock guard(_deletedLock);
+		for (auto it=doomed.begin(); it!=doomed.end(); ++it)
+			_deleted.push_back(it->second);
+	}
+
+	return true;
+}
+
+void SqlObjCleanup::run()
+{
+	_db->threadEnter();
+	_logger.information(Poco::format("Object cleanup started for instance %d (batch %d every %dms)",_serverId,_batchSize,_batchIntervalMS));
+
+	size_t passScanned = 0;
+	size_t passDeleted = 0;
+	UInt32 passStart = GlobalTimer::getMSTime();
+	UInt32 lastReport = passStart;
+	for (;;)
+	{
+		size_t batchScanned = 0;
+		size_t batchDeleted = 0;
+		bool batchOk = processBatch(batchScanned, batchDeleted);
+		passScanned += batchScanned;
+		passDeleted += batchDeleted;
+
+		//a short batch means we've hit the end of the table, a failed one is retried from the same place
+		bool passDone = batchOk && (batchScanned < static_cast<size_t>(_batchSize));
+		UInt32 now = GlobalTimer::getMSTime();
+		if (passDone || GlobalTimer::getMSTimeDiff(lastReport,now) >= PROGRESS_LOG_MS)
+		{
+			double elapsedSec = std::max(GlobalTimer::getMSTimeDiff(passStart,now),UInt32(1)) / 1000.0;
+			_logger.information(Poco::format("Object cleanup %s: scanned %z, deleted %z in %.1fs (%.1f rows/s)",
+				string(passDone ? "pass done" : "progress"),passScanned,passDeleted,elapsedSec,double(passDeleted)/elapsedSec));
+			lastReport = now;
+		}
+
+		long waitMS = _batchIntervalMS;
+		if (passDone)
+		{
+			_cursor = 0;
+			passScanned = 0;
+			passDeleted = 0;
+			waitMS = _passIntervalSec * 1000L;
+		}
+
+		if (_stopEvent.tryWait(waitMS))
+			break;
+
+		if (passDone)
+			passStart = lastReport = GlobalTimer::getMSTime();
+	}
+
+	_logger.information("Object cleanup stopped");
+	_db->threadExit();
+}
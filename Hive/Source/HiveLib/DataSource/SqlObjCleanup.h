@@ -0,0 +1,69 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+
+namespace Poco { class Logger; namespace Util { class AbstractConfiguration; }; };
+class Database;
+
+//walks the deployable table by primary key in small batches, deleting expired and orphaned rows
+//runs on its own thread and database, so the game thread and its connections never wait on it
+class SqlObjCleanup : public Poco::Runnable
+{
+public:
+	SqlObjCleanup(Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf, const string& depTableName);
+	~SqlObjCleanup();
+
+	void start(int serverId);
+	void stop();
+	bool isRunning() const { return _thread.isRunning(); }
+
+	//unique_ids deleted since the last call
+	void takeDeleted(vector<Int64>& out);
+
+	void run() override;
+private:
+	//false if the batch failed and should be retried, the cursor is left where it started
+	bool processBatch(size_t& scanned, size_t& deleted);
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _depTableName;
+
+	int _serverId;
+	int _placedDays;
+	bool _orphaned;
+	int _batchSize;
+	int _batchIntervalMS;
+	int _passIntervalSec;
+
+	Int64 _cursor;
+
+	Poco::Thread _thread;
+	Poco::Event _stopEvent;
+
+	Poco::FastMutex _deletedLock;
+	vector<Int64> _deleted;
+};
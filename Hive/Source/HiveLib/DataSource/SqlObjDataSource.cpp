@@ -21,6 +21,9 @@
 
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/function.hpp>
+#include <ctime>
 using boost::lexical_cast;
 using boost::bad_lexical_cast;
 
@@ -73,31 +76,84 @@ namespace
 	};
 
 	PositionInfo FixOOBWorldspace(Sqf::Value& v, const int max_x, const int max_y) { return boost::apply_visitor(WorldspaceFixerVisitor(max_x, max_y),v); }
+
+	//worldspace is [dir,[x,y,z]]
+	bool GetWorldspacePos(const Sqf::Value& worldSpace, double& x, double& y, double& z)
+	{
+		try
+		{
+			const Sqf::Parameters& ws = boost::get<Sqf::Parameters>(worldSpace);
+			if (ws.size() != 2)
+				return false;
+
+			const Sqf::Parameters& pos = boost::get<Sqf::Parameters>(ws[1]);
+			if (pos.size() < 2)
+				return false;
+
+			x = Sqf::GetDouble(pos[0]);
+			y = Sqf::GetDouble(pos[1]);
+			z = (pos.size() > 2) ? Sqf::GetDouble(pos[2]) : 0;
+			return true;
+		}
+		catch(const boost::bad_get&) {}
+
+		return false;
+	}
 };
 
 #include <Poco/Util/AbstractConfiguration.h>
-SqlObjDataSource::SqlObjDataSource( Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf ) : SqlDataSource(logger,db)
+SqlObjDataSource::SqlObjDataSource( Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf, shared_ptr<Database> cleanupDb ) : SqlDataSource(logger,db),
+	_spatialIndex(conf->getDouble("IndexCellSize",100.0)), _indexedServerId(-1), _dbClockOffset(0)
 {
 	_depTableName = getDB()->escape(conf->getString("Table","instance_deployable"));
 	_vehTableName = getDB()->escape(conf->getString("Table","instance_vehicle"));
-	//_cleanupPlacedDays = conf->getInt("CleanupPlacedAfterDays",6);
 	_objectOOBReset = conf->getBool("ResetOOBObjects",false);
 	//_vehicleOOBReset = conf->getBool("ResetOOBVehicles",false);
+	_parallelLoad = conf->getBool("ParallelLoad",true);
+	_binaryStorage = conf->getBool("BinaryFormat",false);
+	if (conf->getBool("BinaryMigrate",false))
+	{
+		vector<string> cols;
+		cols.push_back("inventory");
+		cols.push_back("parts");
+		convertStoredColumns(_vehTableName, "id", cols, _binaryStorage);
+		cols.back() = "Hitpoints";
+		convertStoredColumns(_depTableName, "id", cols, _binaryStorage);
+	}
+	if (conf->getBool("ColumnMirror",false))
+		_columns.reset(new ObjColumnTable());
+	if (cleanupDb)
+		_cleanup.reset(new SqlObjCleanup(logger,cleanupDb,conf,_depTableName));
 }
 
-void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue )
+#include <Poco/Thread.h>
+
+namespace
+{
+	//both halves select the same columns, so they can run alone or as one union
+	const char* VEHICLES_SQL = "select iv.id as id, v.class_name, 0 as owner_id, iv.worldspace, iv.inventory, iv.parts, iv.fuel, iv.damage, 0 as combination, 0 as deployable, UNIX_TIMESTAMP(iv.`created`) from `%s` iv join `world_vehicle` wv on iv.`world_vehicle_id` = wv.`id` join `vehicle` v on wv.`vehicle_id` = v.`id` where iv.`instance_id` = %d";
+	const char* DEPLOYABLES_SQL = "select id.`unique_id`, d.`class_name`, id.`owner_id`, id.`worldspace`, id.`inventory`, `Hitpoints`, `Fuel`, `Damage`, id.combination, 1 as deployable, UNIX_TIMESTAMP(id.`created`) from `%s` id inner join `deployable` d on id.`deployable_id` = d.`id` where id.`instance_id` = %d AND `deployable_id` IS NOT NULL";
+
+	class FuncRunnable : public Poco::Runnable
+	{
+	public:
+		explicit FuncRunnable(boost::function<void()> func) : _func(func) {}
+		void run() override { _func(); }
+	private:
+		boost::function<void()> _func;
+	};
+};
+
+bool SqlObjDataSource::parseObjects( QueryResult* worldObjsRes, LoadedObjects& out ) const
 {
-	int _cleanupPlacedDays = 1;
 	int max_x = 0;
 	int max_y = 15360;
-	//_logger.warning("Load DB");
-	auto worldObjsRes = getDB()->queryParams("select iv.id as id, v.class_name, 0 as owner_id, iv.worldspace, iv.inventory, iv.parts, iv.fuel, iv.damage, 0 as combination from `%s` iv join `world_vehicle` wv on iv.`world_vehicle_id` = wv.`id` join `vehicle` v on wv.`vehicle_id` = v.`id` where iv.`instance_id` = %d union select id.`unique_id`, d.`class_name`, id.`owner_id`, id.`worldspace`, id.`inventory`, `Hitpoints`, `Fuel`, `Damage`, id.combination from `%s` id inner join `deployable` d on id.`deployable_id` = d.`id` where id.`instance_id` = %d AND `deployable_id` IS NOT NULL", _vehTableName.c_str(), serverId, _depTableName.c_str(), serverId);
 
 	//_logger.warning("Loaded DB");
 	if (!worldObjsRes)
 	{
 		_logger.error("Failed to fetch objects from database");
-		return;
+		return false;
 	}
 	//_logger.warning("worldObjsRes->fetchRow");
 	while (worldObjsRes->fetchRow())
@@ -111,6 +167,7 @@ void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue
 		//objParams.push_back(lexical_cast<string>(objectId)); //objectId should be stringified
 		objParams.push_back(objectId);
 		//_logger.warning("Loaded objParams");
+		LoadedObject loaded;
 		try
 		{
 			objParams.push_back(row[1].getString()); //classname
@@ -130,6 +187,9 @@ void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue
 			//_logger.warning("pushback worldspace");
 			objParams.push_back(worldSpace);
 
+			loaded.x = loaded.y = loaded.z = 0;
+			loaded.hasPos = GetWorldspacePos(worldSpace, loaded.x, loaded.y, loaded.z);
+
 			//Inventory can be NULL
 			{
 				
@@ -137,10 +197,10 @@ void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue
 				if (!row[4].isNull())
 					invStr = row[4].getString(); //inventory
 				//_logger.warning("Loaded objectID from row 4 "); 
-				objParams.push_back(lexical_cast<Sqf::Value>(invStr));
+				objParams.push_back(Sqf::FromStorage(invStr));
 			}	
 			
-			objParams.push_back(lexical_cast<Sqf::Value>(row[5].getCStr())); //Damage
+			objParams.push_back(Sqf::FromStorage(row[5].getString())); //Damage
 			//_logger.warning("Loaded objectID from row 5 ");
 			objParams.push_back(row[6].getDouble()); //Hitpoints
 			//_logger.warning("Loaded objectID from row 6 "); 
@@ -162,8 +222,171 @@ void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue
 			continue;
 		}
 
-		queue.push(objParams);
+		loaded.ident = row[0].getInt64();
+		loaded.byUID = row[9].getBool();
+		loaded.className = row[1].getString();
+		loaded.owner = row[2].getInt32();
+		loaded.fuel = row[6].getDouble();
+		loaded.damage = row[7].getDouble();
+		loaded.created = row[10].getInt32();
+		loaded.params.swap(objParams);
+		out.push_back(loaded);
+	}
+
+	//streamed rows can stop short, a partial object list must not pass for the whole one
+	if (worldObjsRes->incomplete())
+	{
+		_logger.error("Object load broke off after " + lexical_cast<string>(worldObjsRes->numRows()) + " rows");
+		return false;
+	}
+
+	return true;
+}
+
+void SqlObjDataSource::registerObject( const LoadedObject& obj )
+{
+	if (obj.hasPos)
+		_spatialIndex.insert(obj.ident, obj.byUID, obj.className, obj.x, obj.y);
+	if (_columns)
+		_columns->upsert(obj.ident, obj.byUID, obj.className, obj.owner, obj.x, obj.y, obj.z, obj.damage, obj.fuel, obj.created);
+}
+
+void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue )
+{
+	_spatialIndex.clear();
+	if (_columns)
+		_columns->clear();
+	_indexedServerId = serverId;
+
+	if (_columns)
+	{
+		auto nowRes = getDB()->query("select UNIX_TIMESTAMP()");
+		if (nowRes && nowRes->fetchRow())
+			_dbClockOffset = static_cast<Int32>(nowRes->at(0).getInt64() - static_cast<Int64>(time(nullptr)));
+		else
+			_logger.warning("Failed to fetch database time, object ages will use the local clock");
+	}
+
+	LoadedObjects vehicles, deployables;
+	bool loaded = false;
+	if (_parallelLoad)
+	{
+		//deployables on a helper thread, vehicles on this one
+		//consecutive queries land on different pool connections, so neither waits on the other
+		bool depLoaded = false;
+		FuncRunnable depLoader([&]()
+		{
+			getDB()->threadEnter();
+			auto depRes = getDB()->queryParamsStreamed(DEPLOYABLES_SQL, _depTableName.c_str(), serverId);
+			depLoaded = parseObjects(depRes.get(), deployables);
+			getDB()->threadExit();
+		});
+		Poco::Thread depThread("Object Load");
+		depThread.start(depLoader);
+
+		auto vehRes = getDB()->queryParamsStreamed(VEHICLES_SQL, _vehTableName.c_str(), serverId);
+		bool vehLoaded = parseObjects(vehRes.get(), vehicles);
+		depThread.join();
+
+		loaded = vehLoaded && depLoaded;
+		if (!loaded)
+		{
+			_logger.warning("Split object load failed, retrying as a single query");
+			vehicles.clear();
+			deployables.clear();
+		}
+	}
+
+	if (!loaded)
+	{
+		string unionSql = string(VEHICLES_SQL) + " union " + DEPLOYABLES_SQL;
+		auto worldObjsRes = getDB()->queryParamsStreamed(unionSql.c_str(), _vehTableName.c_str(), serverId, _depTableName.c_str(), serverId);
+		if (!parseObjects(worldObjsRes.get(), vehicles))
+			return;
+	}
+
+	//merge on the caller, the index and table aren't thread safe
+	for (auto it=vehicles.begin(); it!=vehicles.end(); ++it)
+	{
+		registerObject(*it);
+		queue.push(it->params);
+	}
+	for (auto it=deployables.begin(); it!=deployables.end(); ++it)
+	{
+		registerObject(*it);
+		queue.push(it->params);
+	}
+
+	if (_cleanup)
+	{
+		_cleanup->start(serverId);
+		applyCleanupDeletes();
+	}
+}
+
+bool SqlObjDataSource::populateChangedObjects( int serverId, Int64 sinceCursor, Int64& newCursor, ServerObjectsQueue& queue )
+{
+	//taken before reading, so anything changing while we read shows up again next time rather than never
+	{
+		auto nowRes = getDB()->query("select UNIX_TIMESTAMP()");
+		if (!nowRes || !nowRes->fetchRow())
+		{
+			_logger.error("Failed to fetch database time for object delta");
+			return false;
+		}
+		newCursor = nowRes->at(0).getInt64();
+	}
+
+	string since = lexical_cast<string>(sinceCursor);
+	LoadedObjects changed;
+	{
+		string vehSql = string(VEHICLES_SQL) + " and iv.`last_updated` >= FROM_UNIXTIME(%s)";
+		auto vehRes = getDB()->queryParams(vehSql.c_str(), _vehTableName.c_str(), serverId, since.c_str());
+		if (!parseObjects(vehRes.get(), changed))
+			return false;
+
+		string depSql = string(DEPLOYABLES_SQL) + " and id.`last_updated` >= FROM_UNIXTIME(%s)";
+		auto depRes = getDB()->queryParams(depSql.c_str(), _depTableName.c_str(), serverId, since.c_str());
+		if (!parseObjects(depRes.get(), changed))
+			return false;
+	}
+
+	auto delRes = getDB()->queryParams("select `object_id`, `deployable` from `object_tombstone` where `instance_id` = %d and `deleted` >= FROM_UNIXTIME(%s)", serverId, since.c_str());
+	if (!delRes)
+	{
+		_logger.error("Failed to fetch object tombstones from database");
+		return false;
+	}
+
+	bool updateIndex = (serverId == _indexedServerId);
+
+	//deletions go first, an id that was deleted then published again must end up existing
+	while (delRes->fetchRow())
+	{
+		Int64 objectIdent = delRes->at(0).getInt64();
+		bool byUID = delRes->at(1).getBool();
+		if (updateIndex)
+		{
+			_spatialIndex.remove(objectIdent, byUID);
+			if (_columns)
+				_columns->remove(objectIdent, byUID);
+		}
+
+		Sqf::Parameters delParams;
+		delParams.push_back(string("DEL"));
+		delParams.push_back(lexical_cast<string>(objectIdent)); //objectId should be stringified
+		delParams.push_back(byUID);
+		queue.push(delParams);
+	}
+
+	for (auto it=changed.begin(); it!=changed.end(); ++it)
+	{
+		if (updateIndex)
+			registerObject(*it);
+		queue.push(it->params);
 	}
+
+	return true;
 }
 
 bool SqlObjDataSource::updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory )
@@ -179,9 +402,10 @@ bool SqlObjDataSource::updateObjectInventory( int serverId, Int64 objectIdent, b
 		stmt = getDB()->makeStatement(_stmtUpdateObjectByID, "update `"+_vehTableName+"` set `inventory` = ? where `id` = ? and `instance_id` = ?");
 	}
 
-	stmt->addString(lexical_cast<string>(inventory));
+	AddStored(stmt.get(), Sqf::ToStorage(inventory, _binaryStorage));
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
+	stmt->setShardKey(objectIdent);
 
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
@@ -202,10 +426,18 @@ bool SqlObjDataSource::deleteObject( int serverId, Int64 objectIdent, bool byUID
 	}
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
+	stmt->setShardKey(objectIdent);
 
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
 
+	if (serverId == _indexedServerId)
+	{
+		_spatialIndex.remove(objectIdent, byUID);
+		if (_columns)
+			_columns->remove(objectIdent, byUID);
+	}
+
 	return exRes;
 }
 
@@ -216,22 +448,37 @@ bool SqlObjDataSource::updateVehicleMovement( int serverId, Int64 objectIdent, c
 	stmt->addDouble(fuel);
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
+	stmt->setShardKey(objectIdent);
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
 
+	double posX, posY, posZ;
+	if (serverId == _indexedServerId && GetWorldspacePos(worldSpace, posX, posY, posZ))
+	{
+		_spatialIndex.move(objectIdent, false, posX, posY);
+		if (_columns)
+			_columns->setPosition(objectIdent, false, posX, posY, posZ);
+	}
+	if (serverId == _indexedServerId && _columns)
+		_columns->setFuel(objectIdent, false, fuel);
+
 	return exRes;
 }
 
 bool SqlObjDataSource::updateVehicleStatus( int serverId, Int64 objectIdent, const Sqf::Value& hitPoints, double damage )
 {
 	auto stmt = getDB()->makeStatement(_stmtUpdateVehicleStatus, "update `"+_vehTableName+"` set `parts` = ?, `damage` = ? where `id` = ? and `instance_id` = ?");
-	stmt->addString(lexical_cast<string>(hitPoints));
+	AddStored(stmt.get(), Sqf::ToStorage(hitPoints, _binaryStorage));
 	stmt->addDouble(damage);
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
+	stmt->setShardKey(objectIdent);
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
 
+	if (serverId == _indexedServerId && _columns)
+		_columns->setDamage(objectIdent, false, damage);
+
 	return exRes;
 }
 
@@ -250,12 +497,13 @@ bool SqlObjDataSource::createObject( int serverId, const string& className, doub
 	stmt->addInt32(characterId); //owner_id
 	stmt->addInt32(serverId); //instance_id
 	stmt->addString(lexical_cast<string>(worldSpace)); //worldspace
-	stmt->addString(lexical_cast<string>(inventory)); //inventory
+	AddStored(stmt.get(), Sqf::ToStorage(inventory, _binaryStorage)); //inventory
 	stmt->addDouble(damage); //Damage
-	stmt->addString(lexical_cast<string>(hitPoints)); //Hitpoints
+	AddStored(stmt.get(), Sqf::ToStorage(hitPoints, _binaryStorage)); //Hitpoints
 	stmt->addDouble(fuel); //Fuel
 	stmt->addInt32(combinationId); //combination
 	stmt->addString(lexical_cast<string>(className));
+	stmt->setShardKey(uniqueId);
 	//stmt->addInt64(objectIdent);
 	//stmt->addString(characterId);
 	//stmt->addInt32(serverId);
@@ -265,6 +513,188 @@ bool SqlObjDataSource::createObject( int serverId, const string& className, doub
 	poco_assert(exRes == true);
 	//_logger.error("Statement " + lexical_cast<string>(_stmtCreateObject) );
 
+	double posX = 0, posY = 0, posZ = 0;
+	bool hasPos = GetWorldspacePos(worldSpace, posX, posY, posZ);
+	if (serverId == _indexedServerId)
+	{
+		if (hasPos)
+			_spatialIndex.insert(uniqueId, true, className, posX, posY);
+		if (_columns)
+			_columns->upsert(uniqueId, true, className, characterId, posX, posY, posZ, damage, fuel, dbNow());
+	}
+
 	return exRes;
 }
 
+bool SqlObjDataSource::indexUsable( int serverId ) const
+{
+	if (serverId != _indexedServerId)
+	{
+		_logger.warning("Object index holds instance " + lexical_cast<string>(_indexedServerId) + ", cannot answer for " + lexical_cast<string>(serverId));
+		return false;
+	}
+	return true;
+}
+
+void SqlObjDataSource::applyCleanupDeletes()
+{
+	if (!_cleanup)
+		return;
+
+	vector<Int64> deleted;
+	_cleanup->takeDeleted(deleted);
+	for (auto it=deleted.begin(); it!=deleted.end(); ++it)
+	{
+		_spatialIndex.remove(*it, true);
+		if (_columns)
+			_columns->remove(*it, true);
+	}
+}
+
+void SqlObjDataSource::queueIndexResults( const ObjSpatialIndex::ResultsType& results, ServerObjectsQueue& queue ) const
+{
+	for (auto it=results.begin(); it!=results.end(); ++it)
+	{
+		const ObjSpatialIndex::Entry& entry = **it;
+
+		Sqf::Parameters objParams;
+		objParams.push_back(lexical_cast<string>(entry.ident)); //objectId should be stringified
+		objParams.push_back(entry.className);
+		objParams.push_back(entry.byUID);
+		objParams.push_back(entry.x);
+		objParams.push_back(entry.y);
+		queue.push(objParams);
+	}
+}
+
+void SqlObjDataSource::objectsInRadius( int serverId, double x, double y, double radius, ServerObjectsQueue& queue )
+{
+	if (!indexUsable(serverId))
+		return;
+
+	applyCleanupDeletes();
+	ObjSpatialIndex::ResultsType results;
+	_spatialIndex.queryRadius(x, y, radius, results);
+	queueIndexResults(results, queue);
+}
+
+void SqlObjDataSource::objectsInBox( int serverId, double x1, double y1, double x2, double y2, ServerObjectsQueue& queue )
+{
+	if (!indexUsable(serverId))
+		return;
+
+	applyCleanupDeletes();
+	ObjSpatialIndex::ResultsType results;
+	_spatialIndex.queryBox(x1, y1, x2, y2, results);
+	queueIndexResults(results, queue);
+}
+
+bool SqlObjDataSource::queryObjectTable( int serverId, const Sqf::Parameters& filters, const string& groupBy, ServerObjectsQueue& queue )
+{
+	if (!_columns)
+	{
+		_logger.warning("Object table query requested but ColumnMirror is disabled");
+		return false;
+	}
+	if (!indexUsable(serverId))
+		return false;
+
+	//each filter is [field,op,value], age is seconds since creation
+	ObjColumnTable::FilterList parsedFilters;
+	for (auto it=filters.begin(); it!=filters.end(); ++it)
+	{
+		try
+		{
+			const Sqf::Parameters& filt = boost::get<Sqf::Parameters>(*it);
+			string fieldName = boost::get<string>(filt.at(0));
+			string opName = boost::get<string>(filt.at(1));
+
+			ObjColumnTable::Filter newFilt;
+			if (!ObjColumnTable::ParseOp(opName, newFilt.op))
+			{
+				_logger.error("Invalid object table operator: " + opName);
+				return false;
+			}
+
+			if (boost::iequals(fieldName,"age"))
+			{
+				//older means created earlier, so the comparison flips
+				newFilt.column = ObjColumnTable::COL_CREATED;
+				newFilt.value = static_cast<double>(dbNow()) - Sqf::GetDouble(filt.at(2));
+				switch (newFilt.op)
+				{
+				case ObjColumnTable::OP_LT: newFilt.op = ObjColumnTable::OP_GT; break;
+				case ObjColumnTable::OP_LE: newFilt.op = ObjColumnTable::OP_GE; break;
+				case ObjColumnTable::OP_GT: newFilt.op = ObjColumnTable::OP_LT; break;
+				case ObjColumnTable::OP_GE: newFilt.op = ObjColumnTable::OP_LE; break;
+				default: break;
+				}
+			}
+			else if (!ObjColumnTable::ParseColumn(fieldName, newFilt.column))
+			{
+				_logger.error("Invalid object table field: " + fieldName);
+				return false;
+			}
+			else if (newFilt.column == ObjColumnTable::COL_CLASS)
+			{
+				//class ids are interned in load order, so only (in)equality means anything
+				if (newFilt.op != ObjColumnTable::OP_EQ && newFilt.op != ObjColumnTable::OP_NE)
+				{
+					_logger.error("Invalid object table operator for class: " + opName);
+					return false;
+				}
+				newFilt.value = _columns->classIdFor(Sqf::GetStringAny(filt.at(2)));
+			}
+			else if (newFilt.column == ObjColumnTable::COL_DEPLOYABLE)
+				newFilt.value = boost::get<bool>(filt.at(2)) ? 1 : 0;
+			else
+				newFilt.value = Sqf::GetDouble(filt.at(2));
+
+			parsedFilters.push_back(newFilt);
+		}
+		catch (const std::exception&)
+		{
+			_logger.error("Invalid object table filter: " + lexical_cast<string>(*it));
+			return false;
+		}
+	}
+
+	applyCleanupDeletes();
+	ObjColumnTable::RowList rows;
+	_columns->select(parsedFilters, rows);
+
+	if (groupBy.length() < 1)
+	{
+		for (auto it=rows.begin(); it!=rows.end(); ++it)
+		{
+			Sqf::Parameters objParams;
+			objParams.push_back(lexical_cast<string>(_columns->ident(*it))); //objectId should be stringified
+			objParams.push_back(_columns->className(_columns->classId(*it)));
+			objParams.push_back(_columns->isDeployable(*it));
+			queue.push(objParams);
+		}
+		return true;
+	}
+
+	ObjColumnTable::Column groupCol;
+	ObjColumnTable::GroupCounts counts;
+	if (!ObjColumnTable::ParseColumn(groupBy, groupCol) || !_columns->countBy(groupCol, rows, counts))
+	{
+		_logger.error("Invalid object table grouping: " + groupBy);
+		return false;
+	}
+
+	for (auto it=counts.begin(); it!=counts.end(); ++it)
+	{
+		Sqf::Parameters groupParams;
+		if (groupCol == ObjColumnTable::COL_CLASS)
+			groupParams.push_back(_columns->className(static_cast<UInt32>(it->first)));
+		else if (groupCol == ObjColumnTable::COL_DEPLOYABLE)
+			groupParams.push_back(it->first != 0);
+		else
+			groupParams.push_back(lexical_cast<string>(it->first));
+		groupParams.push_back(static_cast<int>(it->second));
+		queue.push(groupParams);
+	}
+	return true;
+}
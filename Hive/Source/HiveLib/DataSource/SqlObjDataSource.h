@@ -20,16 +20,23 @@
 
 #include "SqlDataSource.h"
 #include "ObjDataSource.h"
+#include "ObjSpatialIndex.h"
+#include "ObjColumnTable.h"
+#include "SqlObjCleanup.h"
 #include "Database/SqlStatement.h"
 
+#include <ctime>
+
 namespace Poco { namespace Util { class AbstractConfiguration; }; };
+class QueryResult;
 class SqlObjDataSource : public SqlDataSource, public ObjDataSource
 {
 public:
-	SqlObjDataSource(Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf);
+	SqlObjDataSource(Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf, shared_ptr<Database> cleanupDb = shared_ptr<Database>());
 	~SqlObjDataSource() {}
 
 	void populateObjects( int serverId, ServerObjectsQueue& queue ) override;
+	bool populateChangedObjects( int serverId, Int64 sinceCursor, Int64& newCursor, ServerObjectsQueue& queue ) override;
 	bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory ) override;
 	bool deleteObject( int serverId, Int64 objectIdent, bool byUID ) override;
 	bool updateVehicleMovement( int serverId, Int64 objectIdent, const Sqf::Value& worldspace, double fuel ) override;
@@ -37,13 +44,49 @@ public:
 	//bool createObject( int serverId, const string& className, string characterId, const Sqf::Value& worldSpace, Int64 uniqueId ) override;
 	bool createObject( int serverId, const string& className, double damage, int characterId, 
 		const Sqf::Value& worldSpace, const Sqf::Value& inventory, const Sqf::Value& hitPoints, double fuel, Int64 uniqueId, int combinationId  ) override;
+
+	void objectsInRadius( int serverId, double x, double y, double radius, ServerObjectsQueue& queue ) override;
+	void objectsInBox( int serverId, double x1, double y1, double x2, double y2, ServerObjectsQueue& queue ) override;
+	bool queryObjectTable( int serverId, const Sqf::Parameters& filters, const string& groupBy, ServerObjectsQueue& queue ) override;
 private:
 	string _depTableName;
 	string _vehTableName;
 	bool _objectOOBReset;
 
+	bool _parallelLoad;
+	bool _binaryStorage; //inventory and hitpoints
+
+	struct LoadedObject
+	{
+		Sqf::Parameters params;
+		Int64 ident;
+		bool byUID;
+		string className;
+		Int32 owner;
+		bool hasPos;
+		double x, y, z;
+		double damage;
+		double fuel;
+		Int32 created;
+	};
+	typedef vector<LoadedObject> LoadedObjects;
+	bool parseObjects( QueryResult* worldObjsRes, LoadedObjects& out ) const;
+	void registerObject( const LoadedObject& obj );
+
+	bool indexUsable( int serverId ) const;
+	void applyCleanupDeletes();
+	void queueIndexResults( const ObjSpatialIndex::ResultsType& results, ServerObjectsQueue& queue ) const;
+
+	ObjSpatialIndex _spatialIndex;
+	unique_ptr<ObjColumnTable> _columns;
+	int _indexedServerId;
+	//loaded created times come from the database clock, local times are shifted onto it so ages stay comparable
+	Int32 _dbClockOffset;
+	Int32 dbNow() const { return static_cast<Int32>(time(nullptr)) + _dbClockOffset; }
+
+	unique_ptr<SqlObjCleanup> _cleanup;
+
 	//statement ids
-	SqlStatementID _stmtDeleteOldObject;
 	SqlStatementID _stmtUpdateObjectByUID;
 	SqlStatementID _stmtUpdateObjectByID;
 	SqlStatementID _stmtDeleteObjectByUID;
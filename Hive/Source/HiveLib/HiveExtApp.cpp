@@ -82,10 +82,15 @@ HiveExtApp::HiveExtApp(string suffixDir) : AppServer("HiveExt",suffixDir), _serv
 	handlers[308] = boost::bind(&HiveExtApp::objectPublish,this,_1);
 	handlers[309] = boost::bind(&HiveExtApp::objectInventory,this,_1,true);
 	handlers[310] = boost::bind(&HiveExtApp::objectDelete,this,_1,true);
+	handlers[311] = boost::bind(&HiveExtApp::streamObjectsNear,this,_1,false);
+	handlers[312] = boost::bind(&HiveExtApp::streamObjectsNear,this,_1,true);
+	handlers[313] = boost::bind(&HiveExtApp::streamObjectTable,this,_1);
+	handlers[314] = boost::bind(&HiveExtApp::streamObjectChanges,this,_1);
 	//player/character loads
 	handlers[101] = boost::bind(&HiveExtApp::loadPlayer,this,_1);
 	handlers[102] = boost::bind(&HiveExtApp::loadCharacterDetails,this,_1);
 	handlers[103] = boost::bind(&HiveExtApp::recordCharacterLogin,this,_1);
+	handlers[104] = boost::bind(&HiveExtApp::reloadInstance,this,_1);
 	//character updates
 	handlers[201] = boost::bind(&HiveExtApp::playerUpdate,this,_1);
 	handlers[202] = boost::bind(&HiveExtApp::playerDeath,this,_1);
@@ -220,6 +225,97 @@ Sqf::Value HiveExtApp::streamObjects( Sqf::Parameters params )
 	}
 }
 
+Sqf::Value HiveExtApp::streamObjectChanges( Sqf::Parameters params )
+{
+	if (_changedObjects.empty())
+	{
+		int serverId = boost::get<int>(params.at(0));
+		//unix time doesn't fit in an sqf number without losing seconds, so the cursor travels as a string
+		Int64 sinceCursor = 0;
+		if (params.size() > 1 && !Sqf::IsNull(params.at(1)))
+			sinceCursor = Sqf::GetBigInt(params.at(1));
+
+		Int64 newCursor = 0;
+		if (!_objData->populateChangedObjects(serverId, sinceCursor, newCursor, _changedObjects))
+			return booleanReturn(false);
+
+		Sqf::Parameters retVal;
+		retVal.push_back(string("ObjectStreamStart"));
+		retVal.push_back(static_cast<int>(_changedObjects.size()));
+		retVal.push_back(lexical_cast<string>(newCursor));
+		return retVal;
+	}
+	else
+	{
+		Sqf::Parameters retVal = _changedObjects.front();
+		_changedObjects.pop();
+
+		return retVal;
+	}
+}
+
+Sqf::Value HiveExtApp::streamObjectsNear( Sqf::Parameters params, bool inBox /*= false*/ )
+{
+	if (_nearObjects.empty())
+	{
+		if (inBox)
+		{
+			double x1 = Sqf::GetDouble(params.at(0));
+			double y1 = Sqf::GetDouble(params.at(1));
+			double x2 = Sqf::GetDouble(params.at(2));
+			double y2 = Sqf::GetDouble(params.at(3));
+
+			_objData->objectsInBox(getServerId(), x1, y1, x2, y2, _nearObjects);
+		}
+		else
+		{
+			double x = Sqf::GetDouble(params.at(0));
+			double y = Sqf::GetDouble(params.at(1));
+			double radius = Sqf::GetDouble(params.at(2));
+
+			_objData->objectsInRadius(getServerId(), x, y, radius, _nearObjects);
+		}
+
+		Sqf::Parameters retVal;
+		retVal.push_back(string("ObjectStreamStart"));
+		retVal.push_back(static_cast<int>(_nearObjects.size()));
+		return retVal;
+	}
+	else
+	{
+		Sqf::Parameters retVal = _nearObjects.front();
+		_nearObjects.pop();
+
+		return retVal;
+	}
+}
+
+Sqf::Value HiveExtApp::streamObjectTable( Sqf::Parameters params )
+{
+	if (_tableRows.empty())
+	{
+		Sqf::Parameters filters = boost::get<Sqf::Parameters>(params.at(0));
+		string groupBy;
+		if (params.size() > 1 && !Sqf::IsNull(params.at(1)))
+			groupBy = Sqf::GetStringAny(params.at(1));
+
+		if (!_objData->queryObjectTable(getServerId(), filters, groupBy, _tableRows))
+			return booleanReturn(false);
+
+		Sqf::Parameters retVal;
+		retVal.push_back(string("ObjectStreamStart"));
+		retVal.push_back(static_cast<int>(_tableRows.size()));
+		return retVal;
+	}
+	else
+	{
+		Sqf::Parameters retVal = _tableRows.front();
+		_tableRows.pop();
+
+		return retVal;
+	}
+}
+
 Sqf::Value HiveExtApp::streamCustom( Sqf::Parameters params )
 {
 	if (_custQueue.empty())
@@ -334,8 +430,12 @@ Sqf::Value HiveExtApp::recordCharacterLogin( Sqf::Parameters params )
 	string playerId = Sqf::GetStringAny(params.at(0));
 	int characterId = Sqf::GetIntAny(params.at(1));
 	int action = Sqf::GetIntAny(params.at(2));
-	//TODO: Get survivor ID
-	return booleanReturn(_charData->recordLogEntry(playerId,0,getServerId(),action));
+	return booleanReturn(_charData->recordLogEntry(playerId,characterId,getServerId(),action));
+}
+
+Sqf::Value HiveExtApp::reloadInstance( Sqf::Parameters params )
+{
+	return booleanReturn(_charData->reloadInstanceDefaults(getServerId()));
 }
 
 Sqf::Value HiveExtApp::playerUpdate( Sqf::Parameters params )
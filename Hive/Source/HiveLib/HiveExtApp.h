@@ -66,8 +66,15 @@ private:
 	ObjDataSource::ServerObjectsQueue _srvObjects;
 	CustDataSource::CustomDataQueue _custQueue;
 	Sqf::Value streamObjects(Sqf::Parameters params);
+	ObjDataSource::ServerObjectsQueue _changedObjects;
+	Sqf::Value streamObjectChanges(Sqf::Parameters params);
 	Sqf::Value streamCustom(Sqf::Parameters params);
 
+	ObjDataSource::ServerObjectsQueue _nearObjects;
+	Sqf::Value streamObjectsNear(Sqf::Parameters params, bool inBox = false);
+	ObjDataSource::ServerObjectsQueue _tableRows;
+	Sqf::Value streamObjectTable(Sqf::Parameters params);
+
 	Sqf::Value objectPublish(Sqf::Parameters params);
 	Sqf::Value objectInventory(Sqf::Parameters params, bool byUID = false);
 	Sqf::Value objectDelete(Sqf::Parameters params, bool byUID = false);
@@ -78,6 +85,7 @@ private:
 	Sqf::Value loadPlayer(Sqf::Parameters params);
 	Sqf::Value loadCharacterDetails(Sqf::Parameters params);
 	Sqf::Value recordCharacterLogin(Sqf::Parameters params);
+	Sqf::Value reloadInstance(Sqf::Parameters params);
 
 	Sqf::Value playerUpdate(Sqf::Parameters params);
 	Sqf::Value playerInit(Sqf::Parameters params);
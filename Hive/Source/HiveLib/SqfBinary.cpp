@@ -0,0 +1,288 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqfBinary.h"
+
+#include <boost/lexical_cast.hpp>
+#include <cstring>
+
+namespace
+{
+	//text sqf never starts with a zero byte
+	const char BINARY_MAGIC[] = { '\0', 'S', 1 };
+	const size_t MAGIC_LEN = sizeof(BINARY_MAGIC);
+	const int MAX_DEPTH = 64;
+
+	enum ValueTag
+	{
+		TAG_NIL = 0,
+		TAG_FALSE,
+		TAG_TRUE,
+		TAG_INT, //zigzag varint
+		TAG_INT64, //zigzag varint
+		TAG_DOUBLE_INT, //double with an integral value, zigzag varint
+		TAG_FLOAT, //double that survives a trip through float, 4 bytes
+		TAG_DOUBLE, //8 bytes
+		TAG_STRING, //varint length and bytes, added to the dictionary
+		TAG_STRING_REF, //varint dictionary index
+		TAG_ARRAY //varint count and elements
+	};
+
+	inline UInt64 ZigZag(Int64 val) { return (static_cast<UInt64>(val) << 1) ^ static_cast<UInt64>(val >> 63); }
+	inline Int64 UnZigZag(UInt64 val) { return static_cast<Int64>(val >> 1) ^ -static_cast<Int64>(val & 1); }
+
+	class BinaryWriter : public boost::static_visitor<>
+	{
+	public:
+		explicit BinaryWriter(string& out) : _out(out) {}
+
+		void operator()(double val) const
+		{
+			if (val >= -4503599627370496.0 && val <= 4503599627370496.0 && val == static_cast<double>(static_cast<Int64>(val)))
+			{
+				_out.push_back(TAG_DOUBLE_INT);
+				writeVarint(ZigZag(static_cast<Int64>(val)));
+			}
+			else if (static_cast<double>(static_cast<float>(val)) == val)
+			{
+				float fVal = static_cast<float>(val);
+				_out.push_back(TAG_FLOAT);
+				writeRaw(&fVal,sizeof(fVal));
+			}
+			else
+			{
+				_out.push_back(TAG_DOUBLE);
+				writeRaw(&val,sizeof(val));
+			}
+		}
+		void operator()(int val) const
+		{
+			_out.push_back(TAG_INT);
+			writeVarint(ZigZag(val));
+		}
+		void operator()(Int64 val) const
+		{
+			_out.push_back(TAG_INT64);
+			writeVarint(ZigZag(val));
+		}
+		void operator()(bool val) const
+		{
+			_out.push_back(val ? TAG_TRUE : TAG_FALSE);
+		}
+		void operator()(const string& val) const
+		{
+			auto it = _dict.find(val);
+			if (it != _dict.end())
+			{
+				_out.push_back(TAG_STRING_REF);
+				writeVarint(it->second);
+				return;
+			}
+
+			UInt32 idx = static_cast<UInt32>(_dict.size());
+			_dict.insert(std::make_pair(val,idx));
+			_out.push_back(TAG_STRING);
+			writeVarint(val.length());
+			_out.append(val);
+		}
+		void operator()(void* val) const
+		{
+			_out.push_back(TAG_NIL);
+		}
+		void operator()(const Sqf::Parameters& arr) const
+		{
+			_out.push_back(TAG_ARRAY);
+			writeVarint(arr.size());
+			for (auto it=arr.begin();it!=arr.end();++it)
+				boost::apply_visitor(*this,*it);
+		}
+	private:
+		void writeVarint(UInt64 val) const
+		{
+			while (val >= 0x80)
+			{
+				_out.push_back(static_cast<char>((val & 0x7F) | 0x80));
+				val >>= 7;
+			}
+			_out.push_back(static_cast<char>(val));
+		}
+		void writeRaw(const void* data, size_t len) const
+		{
+			//stored little endian, which is what we run on
+			_out.append(static_cast<const char*>(data),len);
+		}
+
+		string& _out;
+		mutable unordered_map<string,UInt32> _dict;
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const char* data, size_t len) : _pos(data), _end(data+len) {}
+
+		Sqf::Value read(int depth)
+		{
+			if (depth > MAX_DEPTH)
+				throw boost::bad_lexical_cast();
+
+			switch (readByte())
+			{
+			case TAG_NIL:
+				return static_cast<void*>(nullptr);
+			case TAG_FALSE:
+				return false;
+			case TAG_TRUE:
+				return true;
+			case TAG_INT:
+				return static_cast<int>(UnZigZag(readVarint()));
+			case TAG_INT64:
+				return UnZigZag(readVarint());
+			case TAG_DOUBLE_INT:
+				return static_cast<double>(UnZigZag(readVarint()));
+			case TAG_FLOAT:
+				{
+					float fVal;
+					readRaw(&fVal,sizeof(fVal));
+					return static_cast<double>(fVal);
+				}
+			case TAG_DOUBLE:
+				{
+					double dVal;
+					readRaw(&dVal,sizeof(dVal));
+					return dVal;
+				}
+			case TAG_STRING:
+				{
+					//checked before narrowing, a huge length mustn't wrap around to a small one on 32bit
+					UInt64 rawLen = readVarint();
+					if (rawLen > static_cast<UInt64>(_end - _pos))
+						throw boost::bad_lexical_cast();
+
+					size_t len = static_cast<size_t>(rawLen);
+
+					_dict.push_back(string(_pos,len));
+					_pos += len;
+					return _dict.back();
+				}
+			case TAG_STRING_REF:
+				{
+					UInt64 idx = readVarint();
+					if (idx >= _dict.size())
+						throw boost::bad_lexical_cast();
+
+					return _dict[static_cast<size_t>(idx)];
+				}
+			case TAG_ARRAY:
+				{
+					UInt64 count = readVarint();
+					//every element takes at least one byte
+					if (count > static_cast<UInt64>(_end - _pos))
+						throw boost::bad_lexical_cast();
+
+					Sqf::Parameters arr;
+					arr.reserve(static_cast<size_t>(count));
+					for (UInt64 i=0;i<count;i++)
+						arr.push_back(read(depth+1));
+
+					return arr;
+				}
+			default:
+				throw boost::bad_lexical_cast();
+			}
+		}
+
+		bool atEnd() const { return _pos == _end; }
+	private:
+		UInt8 readByte()
+		{
+			if (_pos >= _end)
+				throw boost::bad_lexical_cast();
+
+			return static_cast<UInt8>(*_pos++);
+		}
+		UInt64 readVarint()
+		{
+			UInt64 val = 0;
+			for (int shift=0;shift<64;shift+=7)
+			{
+				UInt8 b = readByte();
+				val |= static_cast<UInt64>(b & 0x7F) << shift;
+				if ((b & 0x80) == 0)
+					return val;
+			}
+			throw boost::bad_lexical_cast();
+		}
+		void readRaw(void* out, size_t len)
+		{
+			if (len > static_cast<size_t>(_end - _pos))
+				throw boost::bad_lexical_cast();
+
+			memcpy(out,_pos,len);
+			_pos += len;
+		}
+
+		const char* _pos;
+		const char* _end;
+		vector<string> _dict;
+	};
+};
+
+namespace Sqf
+{
+	bool IsBinary( const string& stored )
+	{
+		return (stored.length() >= MAGIC_LEN && memcmp(stored.data(),BINARY_MAGIC,MAGIC_LEN) == 0);
+	}
+
+	string ToBinary( const Value& val )
+	{
+		string out(BINARY_MAGIC,MAGIC_LEN);
+		boost::apply_visitor(BinaryWriter(out),val);
+		return out;
+	}
+
+	Value FromBinary( const string& stored )
+	{
+		if (!IsBinary(stored))
+			throw boost::bad_lexical_cast();
+
+		BinaryReader reader(stored.data()+MAGIC_LEN,stored.length()-MAGIC_LEN);
+		Value val = reader.read(0);
+		if (!reader.atEnd())
+			throw boost::bad_lexical_cast();
+
+		return val;
+	}
+
+	Value FromStorage( const string& stored )
+	{
+		if (IsBinary(stored))
+			return FromBinary(stored);
+
+		return boost::lexical_cast<Value>(stored);
+	}
+
+	string ToStorage( const Value& val, bool binary )
+	{
+		if (binary)
+			return ToBinary(val);
+
+		return boost::lexical_cast<string>(val);
+	}
+};
@@ -0,0 +1,35 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Sqf.h"
+
+//compact tagged encoding of sqf values, for arrays stored in blob columns
+//integers are varints, repeated strings (class names) refer back to their first occurrence
+namespace Sqf
+{
+	bool IsBinary(const string& stored);
+	string ToBinary(const Value& val);
+	//throws boost::bad_lexical_cast if the data is malformed, same as a failed text parse
+	Value FromBinary(const string& stored);
+
+	//these accept and produce either form, text is the regular sqf notation
+	Value FromStorage(const string& stored);
+	string ToStorage(const Value& val, bool binary);
+}